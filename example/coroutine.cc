@@ -0,0 +1,68 @@
+/* Fetch urls concurrently from coroutines on a single thread.
+ */
+#include "curl++/coroutine.hpp"
+#include "curl++/easy.hpp"
+#include "curl++/global.hpp"
+#include <coroutine>
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+const extern std::vector<const char*> urls;
+
+// minimal fire and forget coroutine type.
+struct detached {
+	struct promise_type {
+		auto get_return_object() noexcept -> detached { return {}; }
+		auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+		auto final_suspend() noexcept -> std::suspend_never { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+struct page : curl::easy_base<page> {
+	size_t on(write w) {
+		body.append(w.data(), w.size());
+		return w.size();
+	}
+	std::string body;
+};
+
+// fetch a url, then fetch it again reusing the connection.
+static auto fetch_twice(curl::client<>& c, const char* url) -> detached
+{
+	page p;
+	p.url(url);
+	for (int i = 0; i < 2; ++i)
+	{
+		p.body.clear();
+		auto cc = co_await c.fetch(p);
+		fprintf(stderr, "R: %d - %s < %s > %zu bytes, %ld new connections\n",
+			cc.value, cc.what(), url, p.body.size(), p.num_connects());
+	}
+}
+
+int main() try {
+	auto g = curl::global();
+	auto c = curl::client<>();
+	for (auto url : urls)
+	{
+		fetch_twice(c, url);
+	}
+	c.run();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
+
+const std::vector<const char*> urls =
+{
+	"https://www.microsoft.com",
+	"https://opensource.org",
+	"https://www.google.com",
+	"https://www.yahoo.com",
+	"https://www.ibm.com",
+	"https://www.iana.org",
+};
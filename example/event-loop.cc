@@ -0,0 +1,103 @@
+/* Download many urls at once using an epoll or io_uring driven event loop.
+ *
+ * usage: event-loop [epoll|uring]
+ */
+#include "curl++/easy.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/uring_loop.hpp"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+const extern std::vector<const char*> urls;
+
+struct nowrite {
+	static size_t on(curl::easy::write w) {
+		return w.size();
+	}
+};
+
+// add a transfer to a multi handle using an existing easy handle.
+static void add_transfer(curl::multi_ref cm, curl::easy_ref ce, const char* url)
+{
+	fprintf(stderr, "Adding url %s\n", url);
+	ce.url(url);
+	ce.userdata(url);
+	ce.set_handler<curl::easy::write, nowrite>();
+	cm.add_handle(ce);
+}
+
+// both loops have the same interface.
+template<typename Loop>
+static void run(curl::multi_ref m)
+{
+	Loop loop(m);
+
+	for (auto const& url : urls)
+	{
+		curl::easy_ref er;
+		er.init();
+		add_transfer(m, er, url);
+	}
+
+	// only ready sockets and expired timers are handled each iteration.
+	while (loop.pending())
+	{
+		loop.run_once();
+		for (auto msg : m.info_read())
+		{
+			if (msg.msg != CURLMSG_DONE)
+			{
+				continue;
+			}
+			auto er = msg.ref;
+			auto cc = msg.result;
+			fprintf(stderr, "R: %d - %s < %s >\n",
+				cc.value, cc.what(),
+				er.userdata<const char*>());
+			m.remove_handle(er);
+			er.reset();
+		}
+	}
+}
+
+int main(int argc, char *argv[]) try {
+	auto g = curl::global();
+	auto m = curl::multi();
+
+	auto uring = argc > 1 && std::strcmp(argv[1], "uring") == 0;
+	if (uring && !curl::uring_loop::supported())
+	{
+		fprintf(stderr, "io_uring not supported, using epoll\n");
+		uring = false;
+	}
+	if (uring)
+	{
+		run<curl::uring_loop>(m);
+	}
+	else
+	{
+		run<curl::epoll_loop>(m);
+	}
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
+
+const std::vector<const char*> urls =
+{
+	"https://www.microsoft.com",
+	"https://opensource.org",
+	"https://www.google.com",
+	"https://www.yahoo.com",
+	"https://www.ibm.com",
+	"https://www.mysql.com",
+	"https://www.oracle.com",
+	"https://www.ripe.net",
+	"https://www.iana.org",
+	"https://www.amazon.com",
+	"https://www.netcraft.com",
+	"https://www.heise.de",
+};
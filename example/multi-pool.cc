@@ -0,0 +1,72 @@
+/* Download urls on several threads, each running its own multi handle.
+ * Requests are routed by host so they reuse the connections of their shard.
+ */
+#include "curl++/easy.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+const extern std::vector<const char*> urls;
+
+struct nowrite {
+	static size_t on(curl::easy::write w) {
+		return w.size();
+	}
+};
+
+int main() try {
+	auto g = curl::global();
+	auto handles = std::vector<curl::easy>(urls.size());
+	auto done = std::atomic<size_t>(0);
+	{
+		auto pool = curl::multi_pool<>(4, 2);
+		for (size_t i = 0; i < urls.size(); ++i)
+		{
+			auto& e = handles[i];
+			auto url = urls[i];
+			e.url(url);
+			e.set_handler<curl::easy::write, nowrite>();
+			auto host = curl::host_key::from_url(url);
+			// called on the worker thread that ran the transfer.
+			pool.submit(host, e, [&, url](curl::easy_ref er, curl::code cc) {
+				fprintf(stderr, "R: %d - %s < %s > %ld new connections\n",
+					cc.value, cc.what(), url,
+					er.num_connects());
+				++done;
+			});
+		}
+		while (done < urls.size())
+		{
+			for (size_t i = 0; i < pool.size(); ++i)
+			{
+				auto s = pool.stats(i);
+				fprintf(stderr, "shard %zu: %zu queued, %zu running\n",
+					i, s.queued, s.running);
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+		}
+	}
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
+
+const std::vector<const char*> urls =
+{
+	"https://www.microsoft.com",
+	"https://opensource.org",
+	"https://www.google.com",
+	"https://www.yahoo.com",
+	"https://www.ibm.com",
+	"https://www.mysql.com",
+	"https://www.oracle.com",
+	"https://www.ripe.net",
+	"https://www.iana.org",
+	"https://www.amazon.com",
+	"https://www.netcraft.com",
+	"https://www.heise.de",
+};
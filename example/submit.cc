@@ -0,0 +1,73 @@
+/* Hand transfers from a producer thread to a thread running a multi handle.
+ * The loop thread is woken as soon as something is submitted instead of
+ * sleeping out its poll timeout.
+ */
+#include "curl++/easy.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/submission_queue.hpp"
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+const extern std::vector<const char*> urls;
+
+struct nowrite {
+	static size_t on(curl::easy::write w) {
+		return w.size();
+	}
+};
+
+int main() try {
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	auto m = curl::multi();
+	auto queue = curl::submission_queue<curl::multi_ref>(m, m);
+	auto handles = std::vector<curl::easy>(urls.size());
+
+	auto producer = std::thread([&] {
+		for (size_t i = 0; i < urls.size(); ++i)
+		{
+			auto& e = handles[i];
+			e.url(urls[i]);
+			e.userdata(urls[i]);
+			e.set_handler<curl::easy::write, nowrite>();
+			queue.add(e);
+			std::this_thread::sleep_for(100ms);
+		}
+	});
+
+	auto done = size_t(0);
+	while (done < urls.size())
+	{
+		// returns early when the producer submits a handle.
+		m.poll(1s);
+		queue.drain();
+		m.perform();
+		for (auto msg : m.info_read())
+		{
+			if (msg.msg == CURLMSG_DONE)
+			{
+				auto cc = msg.result;
+				fprintf(stderr, "R: %d - %s < %s >\n",
+					cc.value, cc.what(),
+					msg.ref.userdata<const char*>());
+				m.remove_handle(msg.ref);
+				++done;
+			}
+		}
+	}
+	producer.join();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
+
+const std::vector<const char*> urls =
+{
+	"https://www.microsoft.com",
+	"https://opensource.org",
+	"https://www.google.com",
+	"https://www.iana.org",
+};
@@ -0,0 +1,153 @@
+#ifndef CURLPLUSPLUS_ADAPTIVE_LIMIT_HPP
+#define CURLPLUSPLUS_ADAPTIVE_LIMIT_HPP
+#include "easy.hpp"
+#include "host_router.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+#include <unordered_map>
+
+namespace curl {
+
+/**
+ * Per host concurrency limit that follows the latency of each host, for use
+ * as the Limit of a scheduler.
+ *
+ * The limit grows by about one transfer for every window of successful
+ * transfers whose latency stays close to the lowest latency seen for the
+ * host, and is cut by a factor when latency rises beyond that, when a
+ * transfer fails, or when the server answers 429 or 503. It is cut at most
+ * once per window, so one burst of slow responses counts as one signal.
+ *
+ * Latency is the time from sending the request to the first response byte,
+ * which leaves out connection setup and the size of the body. The baseline
+ * is the lowest latency seen, and is raised only once the host stays slow
+ * at the lowest limit.
+ *
+ * example usage:
+ * @code
+ *   curl::scheduler<curl::adaptive_limit> s(m);
+ * @endcode
+ */
+struct adaptive_limit {
+	struct options {
+		double initial   = 4;    // limit of a host not seen before.
+		double min       = 1;    // lowest limit.
+		double max       = 256;  // highest limit.
+		double tolerance = 2.0;  // latency over the baseline seen as overload.
+		double backoff   = 0.75; // factor the limit is cut by.
+	};
+
+	adaptive_limit() noexcept
+	: adaptive_limit(options())
+	{}
+
+	explicit adaptive_limit(options o) noexcept
+	: _options(o)
+	{}
+
+	/**
+	 * @returns number of transfers host may run at once.
+	 */
+	auto limit(host_key host) const noexcept -> size_t
+	{
+		auto it = _hosts.find(host.hash);
+		auto l = it == _hosts.end() ? _options.initial : it->second.limit;
+		return static_cast<size_t>(l);
+	}
+
+	/**
+	 * Adjust the limit of host after one of its transfers finished.
+	 *
+	 * @param in_flight number of transfers host was running, including e.
+	 */
+	void update(host_key host, easy_ref e, code result, size_t in_flight) noexcept
+	{
+		try {
+			auto it = _hosts.find(host.hash);
+			if (it == _hosts.end()) {
+				it = _hosts.emplace(host.hash, state{ _options.initial }).first;
+			}
+			adjust(it->second, sample(e, result), in_flight);
+		} catch (std::exception const&) {
+			// leave the limit as is.
+		}
+	}
+
+	/**
+	 * Forget everything learned about host.
+	 */
+	void reset(host_key host) noexcept
+	{
+		_hosts.erase(host.hash);
+	}
+
+private:
+	using duration = std::chrono::microseconds;
+
+	struct state {
+		double   limit;
+		duration baseline = duration::max();
+		double   window   = 0; // transfers since the last cut.
+	};
+
+	struct observation {
+		bool     overload;
+		duration latency;
+	};
+
+	/**
+	 * @throws curl::code
+	 */
+	static auto sample(easy_ref e, code result) -> observation
+	{
+		if (result) {
+			return { true, duration::zero() };
+		}
+		auto status = e.response_code();
+		if (status == 429 || status == 503) {
+			return { true, duration::zero() };
+		}
+		auto latency = e.starttransfer_time() - e.pretransfer_time();
+		if (latency <= duration::zero()) {
+			latency = e.total_time();
+		}
+		return { false, latency };
+	}
+
+	void adjust(state& s, observation o, size_t in_flight) noexcept
+	{
+		s.window += 1;
+		if (!o.overload) {
+			if (o.latency < s.baseline) {
+				s.baseline = o.latency;
+			}
+			o.overload = o.latency.count()
+			           > s.baseline.count() * _options.tolerance;
+			if (o.overload && s.limit <= _options.min) {
+				// slow even with nothing else running, so the host
+				// itself got slower.
+				s.baseline = o.latency;
+				o.overload = false;
+			}
+		}
+		if (o.overload) {
+			if (s.window >= s.limit) {
+				s.limit  = std::max(_options.min, s.limit * _options.backoff);
+				s.window = 0;
+			}
+		} else if (in_flight * 2 >= s.limit) {
+			// only grow a window that is being used.
+			s.limit = std::min(_options.max, s.limit + 1 / s.limit);
+		}
+	}
+
+	options                             _options;
+	std::unordered_map<uint64_t, state> _hosts;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_ADAPTIVE_LIMIT_HPP
@@ -0,0 +1,140 @@
+#ifndef CURLPLUSPLUS_BYTE_RING_HPP
+#define CURLPLUSPLUS_BYTE_RING_HPP
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <mutex>
+
+namespace curl {
+namespace detail {
+
+/**
+ * Bounded ring of bytes with one producer and one consumer, which may be
+ * on different threads.
+ *
+ * Positions are sequentially consistent, so a side that sets a flag and
+ * then checks the ring cannot miss an update the other side made before
+ * checking the flag.
+ */
+struct byte_ring {
+	/**
+	 * @param capacity size of the ring, rounded up to a power of two.
+	 * @throws std::bad_alloc
+	 */
+	explicit byte_ring(size_t capacity)
+	: _capacity(round_up(capacity))
+	, _data(new char[_capacity])
+	{}
+
+	auto capacity() const noexcept -> size_t
+	{
+		return _capacity;
+	}
+
+	/**
+	 * @returns number of bytes that can be popped.
+	 */
+	auto size() const noexcept -> size_t
+	{
+		return _tail.load() - _head.load();
+	}
+
+	/**
+	 * @returns number of bytes that can be pushed.
+	 */
+	auto space() const noexcept -> size_t
+	{
+		return _capacity - size();
+	}
+
+	/**
+	 * Copy as much of p as fits. Producer only.
+	 *
+	 * @returns number of bytes copied.
+	 */
+	auto push(const char* p, size_t n) noexcept -> size_t
+	{
+		auto tail = _tail.load(std::memory_order_relaxed);
+		n = std::min(n, _capacity - (tail - _head.load()));
+		auto at = tail & (_capacity - 1);
+		auto k = std::min(n, _capacity - at);
+		std::memcpy(_data.get() + at, p, k);
+		std::memcpy(_data.get(), p + k, n - k);
+		_tail.store(tail + n);
+		return n;
+	}
+
+	/**
+	 * Copy up to n bytes into p. Consumer only.
+	 *
+	 * @returns number of bytes copied.
+	 */
+	auto pop(char* p, size_t n) noexcept -> size_t
+	{
+		auto head = _head.load(std::memory_order_relaxed);
+		n = std::min(n, _tail.load() - head);
+		auto at = head & (_capacity - 1);
+		auto k = std::min(n, _capacity - at);
+		std::memcpy(p, _data.get() + at, k);
+		std::memcpy(p + k, _data.get(), n - k);
+		_head.store(head + n);
+		return n;
+	}
+
+private:
+	static auto round_up(size_t n) noexcept -> size_t
+	{
+		auto c = size_t(1);
+		while (c < n) {
+			c *= 2;
+		}
+		return c;
+	}
+
+	size_t                  _capacity;
+	std::unique_ptr<char[]> _data;
+	// positions only grow, and wrap around the ring when masked.
+	std::atomic<size_t>     _head{0};
+	std::atomic<size_t>     _tail{0};
+};
+
+/**
+ * Lets a thread sleep until another thread changes some state, without the
+ * other thread taking a lock unless someone is asleep.
+ */
+struct thread_waiter {
+	/**
+	 * Wake the waiting thread, if any. Call after changing the state.
+	 */
+	void notify() noexcept
+	{
+		if (_waiting.load()) {
+			std::lock_guard<std::mutex> lock(_mutex);
+			_cond.notify_one();
+		}
+	}
+
+	/**
+	 * Sleep until ready() is true.
+	 */
+	template<typename F>
+	void wait(F ready)
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_waiting.store(true);
+		_cond.wait(lock, ready);
+		_waiting.store(false, std::memory_order_relaxed);
+	}
+
+private:
+	std::atomic<bool>       _waiting{false};
+	std::mutex              _mutex;
+	std::condition_variable _cond;
+};
+
+} // namespace detail
+} // namespace curl
+#endif // CURLPLUSPLUS_BYTE_RING_HPP
@@ -0,0 +1,323 @@
+#ifndef CURLPLUSPLUS_CHUNKED_BODY_HPP
+#define CURLPLUSPLUS_CHUNKED_BODY_HPP
+#include "buffer.hpp"
+#include "easy.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <string>
+#include <sys/uio.h>
+#include <utility>
+#include <vector>
+
+namespace curl {
+namespace detail {
+
+/**
+ * Per thread free list of fixed size slabs.
+ */
+struct slab_pool {
+	static constexpr size_t slab_size = 64 * 1024;
+	static constexpr size_t max_free  = 64;
+
+	/**
+	 * @returns the pool of the calling thread.
+	 */
+	static auto local() noexcept -> slab_pool&
+	{
+		thread_local slab_pool pool;
+		return pool;
+	}
+
+	slab_pool() = default;
+	slab_pool(slab_pool const&) = delete;
+	auto operator=(slab_pool const&) -> slab_pool& = delete;
+
+	~slab_pool() noexcept
+	{
+		for (auto s : _free) {
+			::operator delete(s);
+		}
+	}
+
+	/**
+	 * @throws std::bad_alloc
+	 */
+	auto get() -> char*
+	{
+		if (_free.empty()) {
+			return static_cast<char*>(::operator new(slab_size));
+		}
+		auto s = _free.back();
+		_free.pop_back();
+		return s;
+	}
+
+	void put(char* s) noexcept
+	{
+		if (_free.size() < max_free) {
+			try {
+				_free.push_back(s);
+				return;
+			} catch (std::bad_alloc const&) {
+			}
+		}
+		::operator delete(s);
+	}
+
+private:
+	std::vector<char*> _free;
+};
+
+} // namespace detail
+
+/**
+ * Response body stored as a list of fixed size slabs, so it grows without
+ * reallocating or copying what was already received.
+ *
+ * Slabs come from a per thread pool, and go back to the pool of the thread
+ * that drops the body.
+ *
+ * example usage:
+ * @code
+ *   curl::chunked_body body;
+ *   e.set_handler<curl::easy_ref::write>(&body);
+ *   e.perform();
+ *   auto iov = body.iovecs();
+ *   ::writev(fd, iov.data(), iov.size());
+ *   for (curl::const_buffer b : body) {
+ *     ...
+ *   }
+ * @endcode
+ */
+struct chunked_body {
+	static constexpr size_t slab_size = detail::slab_pool::slab_size;
+
+	/**
+	 * Iterates over the filled part of each slab.
+	 */
+	struct const_iterator {
+		using iterator_category = std::forward_iterator_tag;
+		using value_type        = const_buffer;
+		using difference_type   = std::ptrdiff_t;
+		using pointer           = const const_buffer*;
+		using reference         = const_buffer;
+
+		auto operator*() const noexcept -> const_buffer
+		{
+			return _body->segment(_index);
+		}
+
+		auto operator++() noexcept -> const_iterator&
+		{
+			++_index;
+			return *this;
+		}
+
+		auto operator++(int) noexcept -> const_iterator
+		{
+			auto x = *this;
+			++_index;
+			return x;
+		}
+
+		bool operator==(const_iterator x) const noexcept
+		{
+			return _index == x._index;
+		}
+
+		bool operator!=(const_iterator x) const noexcept
+		{
+			return _index != x._index;
+		}
+
+	private:
+		friend chunked_body;
+
+		const_iterator(chunked_body const* b, size_t i) noexcept
+		: _body(b)
+		, _index(i)
+		{}
+
+		chunked_body const* _body;
+		size_t              _index;
+	};
+
+	chunked_body() noexcept = default;
+
+	chunked_body(chunked_body&& x) noexcept
+	: _slabs(std::move(x._slabs))
+	, _size(std::exchange(x._size, 0))
+	{
+		x._slabs.clear();
+	}
+
+	auto operator=(chunked_body&& x) noexcept -> chunked_body&
+	{
+		if (this != &x) {
+			clear();
+			_slabs.swap(x._slabs);
+			_size = std::exchange(x._size, 0);
+		}
+		return *this;
+	}
+
+	chunked_body(chunked_body const&) = delete;
+	auto operator=(chunked_body const&) -> chunked_body& = delete;
+
+	/**
+	 * Return slabs to the pool of the calling thread.
+	 */
+	~chunked_body() noexcept
+	{
+		clear();
+	}
+
+	/**
+	 * Append b, taking new slabs as needed.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void append(const_buffer b)
+	{
+		auto p = b.data();
+		auto n = b.size();
+		while (n > 0) {
+			auto used = _size % slab_size;
+			if (used == 0 && _size / slab_size == _slabs.size()) {
+				grow();
+			}
+			auto k = std::min(n, slab_size - used);
+			std::memcpy(_slabs.back() + used, p, k);
+			_size += k;
+			p     += k;
+			n     -= k;
+		}
+	}
+
+	/**
+	 * Append the received data, for use as a handler of write events.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		try {
+			append(w);
+			return w.size();
+		} catch (std::bad_alloc const&) {
+			// fails the transfer with CURLE_WRITE_ERROR.
+			return 0;
+		}
+	}
+
+	/**
+	 * Drop the contents, returning slabs to the pool.
+	 */
+	void clear() noexcept
+	{
+		auto& pool = detail::slab_pool::local();
+		for (auto s : _slabs) {
+			pool.put(s);
+		}
+		_slabs.clear();
+		_size = 0;
+	}
+
+	/**
+	 * @returns number of bytes stored.
+	 */
+	auto size() const noexcept -> size_t
+	{
+		return _size;
+	}
+
+	auto empty() const noexcept -> bool
+	{
+		return _size == 0;
+	}
+
+	/**
+	 * @returns number of filled slabs.
+	 */
+	auto segments() const noexcept -> size_t
+	{
+		return (_size + slab_size - 1) / slab_size;
+	}
+
+	/**
+	 * @returns filled part of slab i.
+	 * @pre i < segments()
+	 */
+	auto segment(size_t i) const noexcept -> const_buffer
+	{
+		auto left = _size - i * slab_size;
+		return { _slabs[i], left < slab_size ? left : slab_size };
+	}
+
+	auto begin() const noexcept -> const_iterator
+	{
+		return { this, 0 };
+	}
+
+	auto end() const noexcept -> const_iterator
+	{
+		return { this, segments() };
+	}
+
+	/**
+	 * @returns scatter list of the contents, for writev and the like.
+	 * @throws std::bad_alloc
+	 */
+	auto iovecs() const -> std::vector<::iovec>
+	{
+		std::vector<::iovec> v;
+		v.reserve(segments());
+		for (auto b : *this) {
+			v.push_back({ const_cast<char*>(b.data()), b.size() });
+		}
+		return v;
+	}
+
+	/**
+	 * Copy the contents to out, which must hold size() bytes.
+	 */
+	void copy_to(char* out) const noexcept
+	{
+		for (auto b : *this) {
+			std::memcpy(out, b.data(), b.size());
+			out += b.size();
+		}
+	}
+
+	/**
+	 * @returns the contents as one contiguous string.
+	 * @throws std::bad_alloc
+	 */
+	auto str() const -> std::string
+	{
+		std::string s(_size, '\0');
+		copy_to(&s[0]);
+		return s;
+	}
+
+private:
+	void grow()
+	{
+		auto& pool = detail::slab_pool::local();
+		auto s = pool.get();
+		try {
+			_slabs.push_back(s);
+		} catch (std::bad_alloc const&) {
+			pool.put(s);
+			throw;
+		}
+	}
+
+	std::vector<char*> _slabs;
+	size_t             _size = 0;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_CHUNKED_BODY_HPP
@@ -0,0 +1,100 @@
+#ifndef CURLPLUSPLUS_COMPLETION_HPP
+#define CURLPLUSPLUS_COMPLETION_HPP
+#include "easy.hpp"
+#include "multi.hpp"
+#include <curl/curl.h>
+namespace curl {
+
+/**
+ * Completion handler of a transfer, invoked by multi_ref::dispatch().
+ *
+ * Attached to an easy handle through CURLOPT_PRIVATE, so the handler of a
+ * finished transfer is found without a lookup. The completion must outlive
+ * the transfer and takes the place of easy_ref::userdata().
+ *
+ * example usage:
+ * @code
+ *   struct request : curl::easy_base<request> {
+ *     curl::completion completion{this};
+ *     void on(curl::multi_ref::done d) {
+ *       // recycle the handle for another transfer.
+ *       url(next_url());
+ *       d.multi.add_handle(d.easy);
+ *     }
+ *   };
+ *   r.completion.attach(r);
+ *   m.add_handle(r);
+ *   ...
+ *   m.dispatch();
+ * @endcode
+ */
+struct completion {
+	using function = void(void*, multi_ref::done);
+
+	/**
+	 * Invoke member function on(done) of x.
+	 */
+	template<typename T>
+	explicit completion(T* x) noexcept
+	: _fn(&member_fn<T>)
+	, _data(x)
+	{}
+
+	/**
+	 * Invoke fn with data.
+	 */
+	completion(function* fn, void* data) noexcept
+	: _fn(fn)
+	, _data(data)
+	{}
+
+	completion(completion const&) = delete;
+	auto operator=(completion const&) -> completion& = delete;
+
+	/**
+	 * Store this completion in CURLOPT_PRIVATE of e.
+	 *
+	 * @throws curl::code
+	 */
+	void attach(easy_ref e)
+	{
+		e.userdata(this);
+	}
+
+	void operator()(multi_ref::done d) const
+	{
+		_fn(_data, d);
+	}
+
+private:
+	template<typename T>
+	static void member_fn(void* x, multi_ref::done d)
+	{
+		static_cast<T*>(x)->on(d);
+	}
+
+	function* _fn;
+	void*     _data;
+};
+
+inline auto multi_ref::dispatch() -> size_t
+{
+	auto count = size_t(0);
+	auto remaining = 0;
+	while (auto msg = ::curl_multi_info_read(_handle, &remaining)) {
+		if (msg->msg != CURLMSG_DONE) {
+			continue;
+		}
+		// msg belongs to the handle, copy out before removing it.
+		auto e = easy_ref(msg->easy_handle);
+		auto d = done{ *this, e, msg->data.result };
+		auto c = e.userdata<completion*>();
+		remove_handle(e);
+		++count;
+		(*c)(d);
+	}
+	return count;
+}
+
+} // namespace curl
+#endif // CURLPLUSPLUS_COMPLETION_HPP
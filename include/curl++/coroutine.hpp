@@ -0,0 +1,159 @@
+#ifndef CURLPLUSPLUS_COROUTINE_HPP
+#define CURLPLUSPLUS_COROUTINE_HPP
+#include "completion.hpp"
+#include "easy.hpp"
+#include "epoll_loop.hpp"
+#include "multi.hpp"
+#include "types.hpp"
+
+#if defined(__cpp_impl_coroutine)
+#include <chrono>
+#include <coroutine>
+
+namespace curl {
+
+/**
+ * Runs transfers on a multi handle and event loop, resuming the coroutine
+ * awaiting each transfer once it is done.
+ *
+ * example usage:
+ * @code
+ *   auto get(curl::client<>& c, curl::easy_ref e) -> some_task {
+ *     curl::code result = co_await c.fetch(e);
+ *     ...
+ *   }
+ * @endcode
+ *
+ * The awaiting coroutine is attached to the easy handle as its completion
+ * while the transfer runs, so it is found without a lookup when the
+ * transfer completes. Coroutines are resumed on the thread calling run(),
+ * as their transfers are dispatched.
+ *
+ * @param Loop event loop type, such as epoll_loop or uring_loop.
+ */
+template<typename Loop = epoll_loop>
+struct client {
+	/**
+	 * Awaitable transfer of an easy handle, resuming with its result.
+	 */
+	struct transfer {
+		auto await_ready() const noexcept -> bool
+		{
+			return false;
+		}
+
+		/**
+		 * Adds the handle to the multi handle.
+		 *
+		 * @throws curl::code
+		 * @throws curl::mcode
+		 */
+		void await_suspend(std::coroutine_handle<> h)
+		{
+			_coroutine = h;
+			_completion.attach(_handle);
+			_client->_multi.add_handle(_handle);
+		}
+
+		auto await_resume() const noexcept -> code
+		{
+			return _result;
+		}
+
+		/**
+		 * Resumes the awaiting coroutine.
+		 */
+		void on(multi_ref::done d)
+		{
+			_result = d.result;
+			_coroutine.resume();
+		}
+
+	private:
+		friend client;
+
+		transfer(client* c, easy_ref e) noexcept
+		: _client(c)
+		, _handle(e)
+		{}
+
+		client*                 _client;
+		easy_ref                _handle;
+		completion              _completion{this};
+		std::coroutine_handle<> _coroutine;
+		code                    _result = CURLE_OK;
+	};
+
+	/**
+	 * @throws std::runtime_error
+	 * @throws std::system_error
+	 */
+	client()
+	: _loop(_multi)
+	{}
+
+	client(client const&) = delete;
+	auto operator=(client const&) -> client& = delete;
+
+	/**
+	 * @returns awaitable that runs the transfer of e.
+	 * @warning e must stay valid until the transfer completes.
+	 */
+	auto fetch(easy_ref e) noexcept -> transfer
+	{
+		return {this, e};
+	}
+
+	/**
+	 * Wait up to timeout for activity, then resume coroutines whose
+	 * transfers completed.
+	 *
+	 * @returns number of running easy handles.
+	 * @throws curl::mcode
+	 * @throws std::system_error
+	 */
+	auto run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1))
+		-> int
+	{
+		_loop.run_once(timeout);
+		_multi.dispatch();
+		return _loop.running();
+	}
+
+	/**
+	 * Run until there are no running transfers.
+	 *
+	 * @throws curl::mcode
+	 * @throws std::system_error
+	 */
+	void run()
+	{
+		while (_loop.pending()) {
+			run_once();
+		}
+	}
+
+	/**
+	 * @returns the multi handle transfers run on, for setting options.
+	 */
+	auto handle() noexcept -> multi_ref
+	{
+		return _multi;
+	}
+
+	/**
+	 * @returns the event loop driving the multi handle.
+	 */
+	auto loop() noexcept -> Loop&
+	{
+		return _loop;
+	}
+
+private:
+	multi _multi;
+	Loop  _loop;
+};
+
+} // namespace curl
+#endif // defined(__cpp_impl_coroutine)
+#endif // CURLPLUSPLUS_COROUTINE_HPP
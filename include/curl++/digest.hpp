@@ -0,0 +1,778 @@
+#ifndef CURLPLUSPLUS_DIGEST_HPP
+#define CURLPLUSPLUS_DIGEST_HPP
+#include "buffer.hpp"
+#include "easy.hpp"
+#include "header_line.hpp"
+#include "types.hpp"
+
+#include <cctype>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <curl/curl.h>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CURLPLUSPLUS_DIGEST_X86 1
+#include <immintrin.h>
+#endif
+
+namespace curl {
+namespace detail {
+
+inline auto load_le64(const unsigned char* p) noexcept -> uint64_t
+{
+	uint64_t x;
+	std::memcpy(&x, p, 8);
+	return x; // x86 and most others are little endian.
+}
+
+inline auto load_le32(const unsigned char* p) noexcept -> uint32_t
+{
+	uint32_t x;
+	std::memcpy(&x, p, 4);
+	return x;
+}
+
+inline auto rotl64(uint64_t x, int r) noexcept -> uint64_t
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+inline auto rotr32(uint32_t x, int r) noexcept -> uint32_t
+{
+	return (x >> r) | (x << (32 - r));
+}
+
+/**
+ * Append x to s as n big endian bytes.
+ */
+inline void append_be(std::string& s, uint64_t x, int n)
+{
+	while (n-- > 0) {
+		s.push_back(static_cast<char>((x >> (8 * n)) & 0xff));
+	}
+}
+
+/**
+ * Decode base64 in b into out.
+ *
+ * @returns false if b is not base64.
+ */
+inline auto base64_decode(const_buffer b, std::string& out) -> bool
+{
+	out.clear();
+	auto bits = uint32_t(0);
+	auto count = 0;
+	for (auto c : b) {
+		int v;
+		if      (c >= 'A' && c <= 'Z') v = c - 'A';
+		else if (c >= 'a' && c <= 'z') v = c - 'a' + 26;
+		else if (c >= '0' && c <= '9') v = c - '0' + 52;
+		else if (c == '+' || c == '-') v = 62;
+		else if (c == '/' || c == '_') v = 63;
+		else if (c == '=')             break;
+		else                           return false;
+		bits = (bits << 6) | static_cast<uint32_t>(v);
+		count += 6;
+		if (count >= 8) {
+			count -= 8;
+			out.push_back(static_cast<char>((bits >> count) & 0xff));
+		}
+	}
+	return true;
+}
+
+/**
+ * CRC32C, the Castagnoli polynomial used by iSCSI and object stores.
+ */
+inline auto crc32c_table() noexcept -> const uint32_t*
+{
+	struct table {
+		uint32_t t[256];
+		table() noexcept
+		{
+			for (uint32_t i = 0; i < 256; ++i) {
+				auto c = i;
+				for (int k = 0; k < 8; ++k) {
+					c = (c & 1) ? (c >> 1) ^ 0x82f63b78u : c >> 1;
+				}
+				t[i] = c;
+			}
+		}
+	};
+	static const table t;
+	return t.t;
+}
+
+inline auto crc32c_scalar(uint32_t crc, const unsigned char* p, size_t n) noexcept -> uint32_t
+{
+	auto t = crc32c_table();
+	while (n-- > 0) {
+		crc = t[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+#ifdef CURLPLUSPLUS_DIGEST_X86
+__attribute__((target("sse4.2")))
+inline auto crc32c_sse42(uint32_t crc, const unsigned char* p, size_t n) noexcept -> uint32_t
+{
+	uint64_t c = crc;
+	for (; n >= 8; n -= 8, p += 8) {
+		c = _mm_crc32_u64(c, load_le64(p));
+	}
+	auto c32 = static_cast<uint32_t>(c);
+	for (; n > 0; --n) {
+		c32 = _mm_crc32_u8(c32, *p++);
+	}
+	return c32;
+}
+#endif
+
+using crc32c_function = uint32_t(uint32_t, const unsigned char*, size_t);
+
+/**
+ * @returns the fastest CRC32C kernel this CPU supports.
+ */
+inline auto crc32c_kernel() noexcept -> crc32c_function*
+{
+#ifdef CURLPLUSPLUS_DIGEST_X86
+	static auto const fn = __builtin_cpu_supports("sse4.2") ? &crc32c_sse42 : &crc32c_scalar;
+	return fn;
+#else
+	return &crc32c_scalar;
+#endif
+}
+
+inline auto sha256_constants() noexcept -> const uint32_t*
+{
+	static constexpr uint32_t k[64] = {
+		0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+		0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+		0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+		0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+		0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+		0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+		0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+		0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+	};
+	return k;
+}
+
+/**
+ * Compress whole 64 byte blocks into state.
+ */
+inline void sha256_scalar(uint32_t* state, const unsigned char* p, size_t blocks) noexcept
+{
+	auto const k = sha256_constants();
+	for (; blocks > 0; --blocks, p += 64) {
+		uint32_t w[64];
+		for (int i = 0; i < 16; ++i) {
+			w[i] = uint32_t(p[4 * i]) << 24 | uint32_t(p[4 * i + 1]) << 16
+			     | uint32_t(p[4 * i + 2]) << 8 | uint32_t(p[4 * i + 3]);
+		}
+		for (int i = 16; i < 64; ++i) {
+			auto s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+			auto s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+			w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+		}
+		auto a = state[0], b = state[1], c = state[2], d = state[3];
+		auto e = state[4], f = state[5], g = state[6], h = state[7];
+		for (int i = 0; i < 64; ++i) {
+			auto s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+			auto ch = (e & f) ^ (~e & g);
+			auto t1 = h + s1 + ch + k[i] + w[i];
+			auto s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+			auto mj = (a & b) ^ (a & c) ^ (b & c);
+			auto t2 = s0 + mj;
+			h = g; g = f; f = e; e = d + t1;
+			d = c; c = b; b = a; a = t1 + t2;
+		}
+		state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+		state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+	}
+}
+
+#ifdef CURLPLUSPLUS_DIGEST_X86
+__attribute__((target("sha,sse4.1")))
+inline void sha256_shani(uint32_t* state, const unsigned char* p, size_t blocks) noexcept
+{
+	auto const mask = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+	auto const ks = sha256_constants();
+	// state is kept as ABEF and CDGH, as the rounds instruction wants.
+	auto tmp    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0]));
+	auto state1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4]));
+	tmp    = _mm_shuffle_epi32(tmp, 0xb1);
+	state1 = _mm_shuffle_epi32(state1, 0x1b);
+	auto state0 = _mm_alignr_epi8(tmp, state1, 8);
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+	for (; blocks > 0; --blocks, p += 64) {
+		auto abef = state0;
+		auto cdgh = state1;
+		__m128i w[4];
+		for (int i = 0; i < 4; ++i) {
+			auto m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+			w[i] = _mm_shuffle_epi8(m, mask);
+		}
+		// four rounds at a time, with w[r % 4] holding words 4r to 4r+3.
+		for (int r = 0; r < 16; ++r) {
+			auto k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ks + 4 * r));
+			auto m = _mm_add_epi32(w[r & 3], k);
+			state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+			m = _mm_shuffle_epi32(m, 0x0e);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, m);
+			if (r < 12) {
+				auto x = _mm_sha256msg1_epu32(w[r & 3], w[(r + 1) & 3]);
+				x = _mm_add_epi32(x, _mm_alignr_epi8(w[(r + 3) & 3], w[(r + 2) & 3], 4));
+				w[r & 3] = _mm_sha256msg2_epu32(x, w[(r + 3) & 3]);
+			}
+		}
+		state0 = _mm_add_epi32(state0, abef);
+		state1 = _mm_add_epi32(state1, cdgh);
+	}
+	tmp    = _mm_shuffle_epi32(state0, 0x1b);
+	state1 = _mm_shuffle_epi32(state1, 0xb1);
+	state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+	state1 = _mm_alignr_epi8(state1, tmp, 8);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+#endif
+
+using sha256_function = void(uint32_t*, const unsigned char*, size_t);
+
+/**
+ * @returns the fastest SHA-256 kernel this CPU supports.
+ */
+inline auto sha256_kernel() noexcept -> sha256_function*
+{
+#ifdef CURLPLUSPLUS_DIGEST_X86
+	static auto const fn = __builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")
+		? &sha256_shani : &sha256_scalar;
+	return fn;
+#else
+	return &sha256_scalar;
+#endif
+}
+
+} // namespace detail
+
+/**
+ * CRC32C of a body, using the SSE4.2 crc32 instruction when available.
+ */
+struct crc32c {
+	/**
+	 * Name of the algorithm in Digest and Content-Digest headers.
+	 */
+	static auto digest_name() noexcept -> const char* { return "crc32c"; }
+
+	/**
+	 * Lowercase name of the header of an object store carrying it.
+	 */
+	static auto checksum_header() noexcept -> const char* { return "x-amz-checksum-crc32c"; }
+
+	void update(const_buffer b) noexcept
+	{
+		_crc = detail::crc32c_kernel()(_crc, reinterpret_cast<const unsigned char*>(b.data()), b.size());
+	}
+
+	void reset() noexcept
+	{
+		_crc = ~uint32_t(0);
+	}
+
+	auto value() const noexcept -> uint32_t
+	{
+		return ~_crc;
+	}
+
+	/**
+	 * @returns the checksum as big endian bytes.
+	 * @throws std::bad_alloc
+	 */
+	auto digest() const -> std::string
+	{
+		std::string s;
+		detail::append_be(s, value(), 4);
+		return s;
+	}
+
+private:
+	uint32_t _crc = ~uint32_t(0);
+};
+
+/**
+ * xxHash64 of a body, which is fast without any special instructions.
+ */
+struct xxhash64 {
+	static auto digest_name() noexcept -> const char* { return nullptr; }
+	static auto checksum_header() noexcept -> const char* { return nullptr; }
+
+	explicit xxhash64(uint64_t seed = 0) noexcept
+	: _seed(seed)
+	{
+		reset();
+	}
+
+	void update(const_buffer b) noexcept
+	{
+		auto p = reinterpret_cast<const unsigned char*>(b.data());
+		auto n = b.size();
+		_total += n;
+		if (_buffered > 0) {
+			auto k = n < 32 - _buffered ? n : 32 - _buffered;
+			std::memcpy(_buffer + _buffered, p, k);
+			_buffered += k;
+			p += k;
+			n -= k;
+			if (_buffered < 32) {
+				return;
+			}
+			stripe(_buffer);
+			_buffered = 0;
+		}
+		for (; n >= 32; n -= 32, p += 32) {
+			stripe(p);
+		}
+		std::memcpy(_buffer, p, n);
+		_buffered = n;
+	}
+
+	void reset() noexcept
+	{
+		_v[0] = _seed + prime1 + prime2;
+		_v[1] = _seed + prime2;
+		_v[2] = _seed;
+		_v[3] = _seed - prime1;
+		_total    = 0;
+		_buffered = 0;
+	}
+
+	auto value() const noexcept -> uint64_t
+	{
+		uint64_t h;
+		if (_total >= 32) {
+			h = detail::rotl64(_v[0], 1) + detail::rotl64(_v[1], 7)
+			  + detail::rotl64(_v[2], 12) + detail::rotl64(_v[3], 18);
+			for (auto v : _v) {
+				h ^= round(0, v);
+				h = h * prime1 + prime4;
+			}
+		} else {
+			h = _seed + prime5;
+		}
+		h += _total;
+		auto p = _buffer;
+		auto n = _buffered;
+		for (; n >= 8; n -= 8, p += 8) {
+			h ^= round(0, detail::load_le64(p));
+			h = detail::rotl64(h, 27) * prime1 + prime4;
+		}
+		if (n >= 4) {
+			h ^= uint64_t(detail::load_le32(p)) * prime1;
+			h = detail::rotl64(h, 23) * prime2 + prime3;
+			p += 4;
+			n -= 4;
+		}
+		for (; n > 0; --n, ++p) {
+			h ^= *p * prime5;
+			h = detail::rotl64(h, 11) * prime1;
+		}
+		h ^= h >> 33;
+		h *= prime2;
+		h ^= h >> 29;
+		h *= prime3;
+		h ^= h >> 32;
+		return h;
+	}
+
+	/**
+	 * @returns the hash as big endian bytes, as it is usually printed.
+	 * @throws std::bad_alloc
+	 */
+	auto digest() const -> std::string
+	{
+		std::string s;
+		detail::append_be(s, value(), 8);
+		return s;
+	}
+
+private:
+	static constexpr uint64_t prime1 = 11400714785074694791ULL;
+	static constexpr uint64_t prime2 = 14029467366897019727ULL;
+	static constexpr uint64_t prime3 =  1609587929392839161ULL;
+	static constexpr uint64_t prime4 =  9650029242287828579ULL;
+	static constexpr uint64_t prime5 =  2870177450012600261ULL;
+
+	static auto round(uint64_t acc, uint64_t input) noexcept -> uint64_t
+	{
+		acc += input * prime2;
+		acc = detail::rotl64(acc, 31);
+		return acc * prime1;
+	}
+
+	void stripe(const unsigned char* p) noexcept
+	{
+		for (int i = 0; i < 4; ++i) {
+			_v[i] = round(_v[i], detail::load_le64(p + 8 * i));
+		}
+	}
+
+	uint64_t      _seed;
+	uint64_t      _v[4];
+	uint64_t      _total    = 0;
+	unsigned char _buffer[32];
+	size_t        _buffered = 0;
+};
+
+/**
+ * SHA-256 of a body, using the SHA extensions when available.
+ */
+struct sha256 {
+	static auto digest_name() noexcept -> const char* { return "sha-256"; }
+	static auto checksum_header() noexcept -> const char* { return "x-amz-checksum-sha256"; }
+
+	sha256() noexcept
+	{
+		reset();
+	}
+
+	void update(const_buffer b) noexcept
+	{
+		auto p = reinterpret_cast<const unsigned char*>(b.data());
+		auto n = b.size();
+		_total += n;
+		if (_buffered > 0) {
+			auto k = n < 64 - _buffered ? n : 64 - _buffered;
+			std::memcpy(_buffer + _buffered, p, k);
+			_buffered += k;
+			p += k;
+			n -= k;
+			if (_buffered < 64) {
+				return;
+			}
+			detail::sha256_kernel()(_state, _buffer, 1);
+			_buffered = 0;
+		}
+		if (n >= 64) {
+			detail::sha256_kernel()(_state, p, n / 64);
+			p += n - n % 64;
+			n %= 64;
+		}
+		std::memcpy(_buffer, p, n);
+		_buffered = n;
+	}
+
+	void reset() noexcept
+	{
+		static constexpr uint32_t init[8] = {
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+			0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+		};
+		std::memcpy(_state, init, sizeof _state);
+		_total    = 0;
+		_buffered = 0;
+	}
+
+	/**
+	 * @returns the 32 byte hash.
+	 * @throws std::bad_alloc
+	 */
+	auto digest() const -> std::string
+	{
+		// pad a copy, so more data can still be added.
+		uint32_t state[8];
+		std::memcpy(state, _state, sizeof state);
+		unsigned char tail[128] = {};
+		std::memcpy(tail, _buffer, _buffered);
+		tail[_buffered] = 0x80;
+		auto blocks = _buffered + 9 > 64 ? 2 : 1;
+		auto bits = _total * 8;
+		for (int i = 0; i < 8; ++i) {
+			tail[blocks * 64 - 1 - i] = static_cast<unsigned char>(bits >> (8 * i));
+		}
+		detail::sha256_kernel()(state, tail, static_cast<size_t>(blocks));
+		std::string s;
+		s.reserve(32);
+		for (auto x : state) {
+			detail::append_be(s, x, 4);
+		}
+		return s;
+	}
+
+private:
+	uint32_t      _state[8];
+	uint64_t      _total    = 0;
+	unsigned char _buffer[64];
+	size_t        _buffered = 0;
+};
+
+/**
+ * Computes digests of a response body as it is received, and checks them
+ * against expected values once it is complete, saving a second pass over
+ * the body.
+ *
+ * Expected values are given with expect(), or taken from the response:
+ * a Digest, Content-Digest or Repr-Digest header naming the algorithm,
+ * or the checksum header of an object store such as
+ * x-amz-checksum-sha256. A value given with expect() takes precedence.
+ * Digests are of the body as delivered by write events, so a header
+ * describing the encoded content does not match if libcurl decodes it.
+ *
+ * Every status line starts over, so only the final response of a redirect
+ * counts.
+ *
+ * example usage:
+ * @code
+ *   struct download : curl::easy_base<download> {
+ *     curl::digest_stage<curl::crc32c, curl::sha256> digests;
+ *     curl::pwrite_sink file{"out.bin"};
+ *     auto on(header h) noexcept -> size_t { return digests.on(h); }
+ *     auto on(write w) noexcept -> size_t {
+ *       digests.on(w);
+ *       return file.on(w);
+ *     }
+ *   };
+ *   d.perform();
+ *   if (!d.digests.ok()) { ... }
+ * @endcode
+ *
+ * @param Digests digest types, such as crc32c, xxhash64 or sha256.
+ */
+template<typename... Digests>
+struct digest_stage {
+	enum class verdict {
+		unchecked, // no expected value.
+		match,
+		mismatch,
+	};
+
+	/**
+	 * Expect the body to have digest raw, as bytes rather than encoded.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	template<typename D>
+	void expect(std::string raw)
+	{
+		auto& s = std::get<slot<D>>(_slots);
+		s.expected = std::move(raw);
+		s.pinned   = true;
+	}
+
+	/**
+	 * Look for the status line and headers carrying digests, for use as a
+	 * handler of header events.
+	 *
+	 * @returns 0 to fail the transfer if out of memory.
+	 */
+	auto on(easy_ref::header h) noexcept -> size_t
+	{
+		try {
+			if (detail::is_status_line(h)) {
+				reset();
+			} else {
+				each([&](auto& s) { from_header(s, h); });
+			}
+			return h.size();
+		} catch (std::bad_alloc const&) {
+			return 0;
+		}
+	}
+
+	/**
+	 * Add the received data to every digest, for use as a handler of write
+	 * events, or from one that also stores it.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		each([&](auto& s) { s.digest.update(w); });
+		return w.size();
+	}
+
+	/**
+	 * @returns digest of type D computed so far.
+	 */
+	template<typename D>
+	auto get() const noexcept -> D const&
+	{
+		return std::get<slot<D>>(_slots).digest;
+	}
+
+	/**
+	 * @returns how the digest of type D compares to its expected value.
+	 * @throws std::bad_alloc
+	 */
+	template<typename D>
+	auto check() const -> verdict
+	{
+		auto& s = std::get<slot<D>>(_slots);
+		if (s.expected.empty()) {
+			return verdict::unchecked;
+		}
+		return s.digest.digest() == s.expected ? verdict::match : verdict::mismatch;
+	}
+
+	/**
+	 * @returns false iff a digest does not match its expected value.
+	 * @throws std::bad_alloc
+	 */
+	auto ok() const -> bool
+	{
+		auto good = true;
+		each([&](auto const& s) {
+			good = good && check<typename std::decay_t<decltype(s)>::type>() != verdict::mismatch;
+		});
+		return good;
+	}
+
+	/**
+	 * @returns true iff at least one digest had an expected value.
+	 */
+	auto checked() const noexcept -> bool
+	{
+		auto any = false;
+		each([&](auto const& s) { any = any || !s.expected.empty(); });
+		return any;
+	}
+
+	/**
+	 * @returns the result of a transfer, with a successful one reported as
+	 *          CURLE_BAD_CONTENT_ENCODING if a digest did not match.
+	 * @throws std::bad_alloc
+	 */
+	auto result(code c) const -> code
+	{
+		if (!c && !ok()) {
+			return CURLE_BAD_CONTENT_ENCODING;
+		}
+		return c;
+	}
+
+	/**
+	 * Start over for another body, keeping values given with expect().
+	 */
+	void reset() noexcept
+	{
+		each([](auto& s) {
+			s.digest.reset();
+			if (!s.pinned) {
+				s.expected.clear();
+			}
+		});
+	}
+
+private:
+	template<typename D>
+	struct slot {
+		using type = D;
+		D           digest;
+		std::string expected;
+		bool        pinned = false;
+	};
+
+	template<typename F>
+	void each(F f)
+	{
+		each(f, std::index_sequence_for<Digests...>());
+	}
+
+	template<typename F>
+	void each(F f) const
+	{
+		each(f, std::index_sequence_for<Digests...>());
+	}
+
+	template<typename F, size_t... I>
+	void each(F& f, std::index_sequence<I...>)
+	{
+		int expand[] = { 0, (f(std::get<I>(_slots)), 0)... };
+		(void)expand;
+	}
+
+	template<typename F, size_t... I>
+	void each(F& f, std::index_sequence<I...>) const
+	{
+		int expand[] = { 0, (f(std::get<I>(_slots)), 0)... };
+		(void)expand;
+	}
+
+	/**
+	 * Take the expected value of s from header line h, if it carries one.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	template<typename D>
+	static void from_header(slot<D>& s, const_buffer h)
+	{
+		if (s.pinned) {
+			return;
+		}
+		auto header = D::checksum_header();
+		if (header != nullptr && detail::header_is(h, header)) {
+			if (!detail::base64_decode(detail::header_value(h), s.expected)) {
+				s.expected.clear();
+			}
+			return;
+		}
+		auto name = D::digest_name();
+		if (name == nullptr
+		 || !(detail::header_is(h, "digest") || detail::header_is(h, "content-digest")
+		   || detail::header_is(h, "repr-digest"))) {
+			return;
+		}
+		// a list of algorithm=value, with values of the newer headers
+		// enclosed in colons.
+		auto v = detail::header_value(h);
+		auto p = v.data();
+		auto end = p + v.size();
+		while (p != end) {
+			auto comma = static_cast<const char*>(std::memchr(p, ',', static_cast<size_t>(end - p)));
+			auto item_end = comma != nullptr ? comma : end;
+			while (p != item_end && (*p == ' ' || *p == '\t')) {
+				++p;
+			}
+			auto eq = static_cast<const char*>(std::memchr(p, '=', static_cast<size_t>(item_end - p)));
+			if (eq != nullptr && names_equal(p, static_cast<size_t>(eq - p), name)) {
+				auto a = eq + 1;
+				auto b = item_end;
+				while (b != a && (b[-1] == ' ' || b[-1] == '\t')) {
+					--b;
+				}
+				if (b != a && *a == ':') {
+					++a;
+				}
+				if (b != a && b[-1] == ':') {
+					--b;
+				}
+				if (!detail::base64_decode({ a, static_cast<size_t>(b - a) }, s.expected)) {
+					s.expected.clear();
+				}
+				return;
+			}
+			p = item_end == end ? end : item_end + 1;
+		}
+	}
+
+	static auto names_equal(const char* p, size_t n, const char* name) noexcept -> bool
+	{
+		if (std::strlen(name) != n) {
+			return false;
+		}
+		for (size_t i = 0; i < n; ++i) {
+			if (std::tolower(static_cast<unsigned char>(p[i])) != name[i]) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	std::tuple<slot<Digests>...> _slots;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_DIGEST_HPP
@@ -114,7 +114,7 @@ struct easy_ref
 	 */
 	void pause(pause_t flags)
 	{
-		invoke(::curl_easy_pause, _handle, flags.value);
+		curl::invoke(::curl_easy_pause, _handle, flags.value);
 	}
 
 	/**
@@ -125,7 +125,7 @@ struct easy_ref
 	 */
 	void perform()
 	{
-		invoke(::curl_easy_perform, _handle);
+		curl::invoke(::curl_easy_perform, _handle);
 	}
 
 	/**
@@ -138,7 +138,7 @@ struct easy_ref
 	template<typename T>
 	void setopt(CURLoption o, T x)
 	{
-		invoke(::curl_easy_setopt, _handle, o, x);
+		curl::invoke(::curl_easy_setopt, _handle, o, x);
 	}
 
 	/**
@@ -161,6 +161,8 @@ struct easy_ref
 	SETOPT_FUNC(verbose         , VERBOSE        , bool);
 	SETOPT_FUNC(no_progress     , NOPROGRESS     , bool);
 	SETOPT_FUNC(follow_location , FOLLOWLOCATION , bool);
+	SETOPT_FUNC(no_body         , NOBODY         , bool);
+	SETOPT_FUNC(range           , RANGE          , std::string);
 	SETOPT_FUNC(error_buffer    , ERRORBUFFER    , error_buffer);
 	SETOPT_FUNC(share           , SHARE          , detail::handle_base<CURLSH*>);
 
@@ -195,6 +197,7 @@ struct easy_ref
 
 	GETINFO_FUNC(redirect_count          , REDIRECT_COUNT           , long);
 	GETINFO_FUNC(redirect_url            , REDIRECT_URL             , std::string);
+	GETINFO_FUNC(num_connects            , NUM_CONNECTS             , long);
 	// bytes
 	GETINFO_FUNC(size_upload             , SIZE_UPLOAD_T            , curl_off_t);
 	GETINFO_FUNC(size_download           , SIZE_DOWNLOAD_T          , curl_off_t);
@@ -300,6 +303,25 @@ struct easy_base : public easy {
 	 * class, or do nothing if there is no handler.
 	 */
 	easy_base() noexcept
+	{
+		set_handlers();
+	}
+
+	/**
+	 * Take ownership of an existing handle, such as one cloned from a
+	 * prototype, and set up handlers on it.
+	 */
+	explicit easy_base(easy_ref er) noexcept
+	: easy(er)
+	{
+		set_handlers();
+	}
+
+	/**
+	 * Sets up handlers for events, needed again after the handle has been
+	 * reset or replaced.
+	 */
+	void set_handlers() noexcept
 	{
 		set_handler< debug,    true >(self());
 		set_handler< header,   true >(self());
@@ -0,0 +1,441 @@
+#ifndef CURLPLUSPLUS_EASY_POOL_HPP
+#define CURLPLUSPLUS_EASY_POOL_HPP
+#include "easy.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <curl/curl.h>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace curl {
+
+namespace detail {
+
+template<typename T, typename = void>
+struct has_set_handlers : std::false_type {};
+
+template<typename T>
+struct has_set_handlers<T, decltype(std::declval<T&>().set_handlers())>
+	: std::true_type {};
+
+/**
+ * Restores the default value of options that are known to be safe to set
+ * back individually.
+ */
+struct option_defaults {
+	/**
+	 * @returns true iff o changes the request method and needs
+	 *          CURLOPT_HTTPGET to undo.
+	 */
+	static auto changes_method(CURLoption o) noexcept -> bool
+	{
+		switch (o) {
+		case CURLOPT_NOBODY:
+		case CURLOPT_POST:
+		case CURLOPT_UPLOAD:
+		case CURLOPT_POSTFIELDS:
+		case CURLOPT_COPYPOSTFIELDS:
+		case CURLOPT_MIMEPOST:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	/**
+	 * Set o back to its default.
+	 *
+	 * @returns false if the default of o is not known, or restoring it
+	 *          would undo handler wiring.
+	 */
+	static auto restore(CURL* e, CURLoption o) noexcept -> bool
+	{
+		auto info = ::curl_easy_option_by_id(o);
+		if (info == nullptr) {
+			return false;
+		}
+		switch (info->type) {
+		case CURLOT_STRING:
+		case CURLOT_BLOB:
+			if (builtin_default(o)) {
+				return false;
+			}
+			return ::curl_easy_setopt(e, o, nullptr) == CURLE_OK;
+		case CURLOT_OBJECT:
+		case CURLOT_SLIST:
+			return ::curl_easy_setopt(e, o, nullptr) == CURLE_OK;
+		case CURLOT_LONG:
+		case CURLOT_VALUES:
+		case CURLOT_OFF_T:
+			break;
+		default:
+			// callbacks and their data pointers.
+			return false;
+		}
+		auto it = find(o);
+		if (it == nullptr) {
+			return false;
+		}
+		auto r = info->type == CURLOT_OFF_T
+			? ::curl_easy_setopt(e, o, static_cast<curl_off_t>(it->value))
+			: ::curl_easy_setopt(e, o, static_cast<long>(it->value));
+		return r == CURLE_OK;
+	}
+
+private:
+	/**
+	 * @returns true iff o has a default chosen when libcurl was built,
+	 *          which setting it to null would clear instead of restore.
+	 */
+	static auto builtin_default(CURLoption o) noexcept -> bool
+	{
+		switch (o) {
+		case CURLOPT_CAINFO:
+		case CURLOPT_CAPATH:
+		case CURLOPT_PROXY_CAINFO:
+		case CURLOPT_PROXY_CAPATH:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	struct entry {
+		CURLoption option;
+		long       value;
+	};
+
+	static auto find(CURLoption o) noexcept -> entry const*
+	{
+		static constexpr entry table[] = {
+			{ CURLOPT_VERBOSE               , 0 },
+			{ CURLOPT_HEADER                , 0 },
+			{ CURLOPT_NOPROGRESS            , 1 },
+			{ CURLOPT_NOSIGNAL              , 0 },
+			{ CURLOPT_FAILONERROR           , 0 },
+			{ CURLOPT_FOLLOWLOCATION        , 0 },
+			{ CURLOPT_AUTOREFERER           , 0 },
+			{ CURLOPT_UNRESTRICTED_AUTH     , 0 },
+			{ CURLOPT_NOBODY                , 0 },
+			{ CURLOPT_POST                  , 0 },
+			{ CURLOPT_UPLOAD                , 0 },
+			{ CURLOPT_HTTPGET               , 1 },
+			{ CURLOPT_POSTFIELDSIZE         , -1 },
+			{ CURLOPT_POSTFIELDSIZE_LARGE   , -1 },
+			{ CURLOPT_INFILESIZE            , -1 },
+			{ CURLOPT_INFILESIZE_LARGE      , -1 },
+			{ CURLOPT_RESUME_FROM           , 0 },
+			{ CURLOPT_RESUME_FROM_LARGE     , 0 },
+			{ CURLOPT_MAXFILESIZE           , 0 },
+			{ CURLOPT_MAXFILESIZE_LARGE     , 0 },
+			{ CURLOPT_MAX_SEND_SPEED_LARGE  , 0 },
+			{ CURLOPT_MAX_RECV_SPEED_LARGE  , 0 },
+			{ CURLOPT_TIMEOUT               , 0 },
+			{ CURLOPT_TIMEOUT_MS            , 0 },
+			{ CURLOPT_CONNECTTIMEOUT        , 0 },
+			{ CURLOPT_CONNECTTIMEOUT_MS     , 0 },
+			{ CURLOPT_LOW_SPEED_LIMIT       , 0 },
+			{ CURLOPT_LOW_SPEED_TIME        , 0 },
+			{ CURLOPT_FRESH_CONNECT         , 0 },
+			{ CURLOPT_FORBID_REUSE          , 0 },
+			{ CURLOPT_FILETIME              , 0 },
+			{ CURLOPT_TRANSFER_ENCODING     , 0 },
+			{ CURLOPT_HTTP_CONTENT_DECODING , 1 },
+			{ CURLOPT_HTTP_TRANSFER_DECODING, 1 },
+			{ CURLOPT_HTTP_VERSION          , CURL_HTTP_VERSION_NONE },
+			{ CURLOPT_HTTPAUTH              , static_cast<long>(CURLAUTH_BASIC) },
+			{ CURLOPT_NETRC                 , CURL_NETRC_IGNORED },
+			{ CURLOPT_IPRESOLVE             , CURL_IPRESOLVE_WHATEVER },
+			{ CURLOPT_SSL_VERIFYPEER        , 1 },
+			{ CURLOPT_SSL_VERIFYHOST        , 2 },
+			{ CURLOPT_TCP_NODELAY           , 1 },
+			{ CURLOPT_TCP_KEEPALIVE         , 0 },
+		};
+		auto it = std::find_if(std::begin(table), std::end(table),
+			[o](entry const& x) { return x.option == o; });
+		return it == std::end(table) ? nullptr : it;
+	}
+};
+
+} // namespace detail
+
+/**
+ * Pool of easy handles that are recycled rather than created for every
+ * request.
+ *
+ * A lease keeps track of the options set through it. When it is returned
+ * only those options are set back to their defaults, so handler wiring,
+ * other options T set when constructed, and the handle's connection, DNS
+ * and TLS session caches all survive at the cost of a setopt per changed
+ * option. An option that both T and the lease set goes back to libcurl's
+ * default rather than to what T set.
+ *
+ * Options set directly on the handle, such as through the named setters
+ * reached with operator->, are not seen by the lease; record them with
+ * touch(), or use touch_all() when that is impractical. If an option
+ * without a known default was changed, such as a callback or a CA path,
+ * the handle is reset completely with curl_easy_reset and the handlers of
+ * types derived from easy_base are set up again. That fallback also clears
+ * any other option T set when constructed.
+ *
+ * example usage:
+ * @code
+ *   curl::easy_pool<request> pool;
+ *   {
+ *     auto e = pool.acquire();
+ *     e.setopt(CURLOPT_URL, "http://example.com");
+ *     e.setopt(CURLOPT_POST, 1L);
+ *     e->perform();
+ *   } // back in the pool with the url and method cleared.
+ * @endcode
+ *
+ * Idle handles are capped by an estimate of the memory they hold, and the
+ * most recently used handle is handed out first.
+ * The pool is not thread safe; use one per thread running transfers.
+ *
+ * @param T easy type to pool, such as easy or a type derived from
+ *        easy_base. Must be default constructible.
+ */
+template<typename T = easy>
+struct easy_pool {
+	/**
+	 * Rough memory held by an easy handle that has run a transfer.
+	 */
+	static constexpr size_t default_handle_bytes = 16 * 1024;
+
+	struct lease;
+
+	/**
+	 * @param max_idle_bytes memory idle handles may hold.
+	 * @param handle_bytes estimated memory held by each handle.
+	 */
+	explicit easy_pool(size_t max_idle_bytes = 4 * 1024 * 1024,
+	                   size_t handle_bytes = default_handle_bytes) noexcept
+	: _handle_bytes(std::max<size_t>(handle_bytes, 1))
+	, _max_idle(max_idle_bytes / _handle_bytes)
+	{}
+
+	easy_pool(easy_pool const&) = delete;
+	auto operator=(easy_pool const&) -> easy_pool& = delete;
+
+	/**
+	 * @returns an idle handle, or a new one if there are none.
+	 * @throws std::runtime_error
+	 * @throws std::bad_alloc
+	 */
+	auto acquire() -> lease;
+
+	/**
+	 * @returns number of idle handles.
+	 */
+	auto idle() const noexcept -> size_t
+	{
+		return _idle.size();
+	}
+
+	/**
+	 * @returns estimated memory held by idle handles.
+	 */
+	auto idle_bytes() const noexcept -> size_t
+	{
+		return _idle.size() * _handle_bytes;
+	}
+
+	/**
+	 * Change the memory idle handles may hold, freeing the least recently
+	 * used handles beyond it.
+	 */
+	void shrink(size_t max_idle_bytes) noexcept
+	{
+		_max_idle = max_idle_bytes / _handle_bytes;
+		if (_idle.size() > _max_idle) {
+			auto extra = _idle.size() - _max_idle;
+			_idle.erase(_idle.begin(), _idle.begin() + extra);
+		}
+	}
+
+private:
+	struct slot {
+		T                       handle;
+		std::vector<CURLoption> touched;
+		bool                    dirty = false;
+	};
+
+	void recycle(std::unique_ptr<slot> s) noexcept
+	{
+		if (_idle.size() >= _max_idle) {
+			return;
+		}
+		restore(*s);
+		try {
+			_idle.push_back(std::move(s));
+		} catch (std::bad_alloc const&) {
+		}
+	}
+
+	/**
+	 * Set touched options back to their defaults, or reset the handle if
+	 * that is not possible.
+	 */
+	static void restore(slot& s) noexcept
+	{
+		auto e = s.handle.raw();
+		auto method = false;
+		for (auto o : s.touched) {
+			if (s.dirty) {
+				break;
+			}
+			s.dirty = !detail::option_defaults::restore(e, o);
+			method = method || detail::option_defaults::changes_method(o);
+		}
+		if (!s.dirty && method) {
+			s.dirty = ::curl_easy_setopt(e, CURLOPT_POSTFIELDSIZE_LARGE,
+			                             curl_off_t(-1)) != CURLE_OK
+			       || ::curl_easy_setopt(e, CURLOPT_HTTPGET, 1L) != CURLE_OK;
+		}
+		s.touched.clear();
+		if (s.dirty) {
+			s.dirty = false;
+			::curl_easy_reset(e);
+			rewire(s.handle, detail::has_set_handlers<T>());
+		}
+	}
+
+	static void rewire(T& handle, std::true_type) noexcept
+	{
+		handle.set_handlers();
+	}
+
+	static void rewire(T&, std::false_type) noexcept
+	{
+	}
+
+	size_t                             _handle_bytes;
+	size_t                             _max_idle;
+	std::vector<std::unique_ptr<slot>> _idle;
+};
+
+/**
+ * Handle borrowed from an easy_pool, returned to it on destruction.
+ */
+template<typename T>
+struct easy_pool<T>::lease {
+	lease() noexcept = default;
+
+	lease(lease&& x) noexcept
+	: _pool(std::exchange(x._pool, nullptr))
+	, _slot(std::move(x._slot))
+	{}
+
+	auto operator=(lease&& x) noexcept -> lease&
+	{
+		if (this != &x) {
+			give_back();
+			_pool = std::exchange(x._pool, nullptr);
+			_slot = std::move(x._slot);
+		}
+		return *this;
+	}
+
+	~lease() noexcept
+	{
+		give_back();
+	}
+
+	/**
+	 * see curl_easy_setopt.
+	 * The option is set back to its default when the lease ends.
+	 *
+	 * @throws curl::code
+	 * @throws std::bad_alloc
+	 * @pre *this
+	 */
+	template<typename V>
+	void setopt(CURLoption o, V x)
+	{
+		touch(o);
+		_slot->handle.setopt(o, x);
+	}
+
+	/**
+	 * Record that o was set by other means, such as the named setters of
+	 * easy_ref, so it is set back to its default when the lease ends.
+	 *
+	 * @throws std::bad_alloc
+	 * @pre *this
+	 */
+	void touch(CURLoption o)
+	{
+		auto& t = _slot->touched;
+		if (std::find(t.begin(), t.end(), o) == t.end()) {
+			t.push_back(o);
+		}
+	}
+
+	/**
+	 * Reset the handle completely when the lease ends, for when options
+	 * were changed without being recorded.
+	 *
+	 * @pre *this
+	 */
+	void touch_all() noexcept
+	{
+		_slot->dirty = true;
+	}
+
+	auto get() const noexcept -> T*
+	{
+		return &_slot->handle;
+	}
+
+	auto operator*() const noexcept -> T&
+	{
+		return _slot->handle;
+	}
+
+	auto operator->() const noexcept -> T*
+	{
+		return &_slot->handle;
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return _slot != nullptr;
+	}
+
+private:
+	friend easy_pool;
+
+	lease(easy_pool* p, std::unique_ptr<slot> s) noexcept
+	: _pool(p)
+	, _slot(std::move(s))
+	{}
+
+	void give_back() noexcept
+	{
+		if (_slot != nullptr) {
+			_pool->recycle(std::move(_slot));
+		}
+		_pool = nullptr;
+	}
+
+	easy_pool*            _pool = nullptr;
+	std::unique_ptr<slot> _slot;
+};
+
+template<typename T>
+auto easy_pool<T>::acquire() -> lease
+{
+	if (_idle.empty()) {
+		return { this, std::unique_ptr<slot>(new slot) };
+	}
+	auto s = std::move(_idle.back());
+	_idle.pop_back();
+	return { this, std::move(s) };
+}
+
+} // namespace curl
+#endif // CURLPLUSPLUS_EASY_POOL_HPP
@@ -0,0 +1,254 @@
+#ifndef CURLPLUSPLUS_EPOLL_LOOP_HPP
+#define CURLPLUSPLUS_EPOLL_LOOP_HPP
+#include "multi.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <curl/curl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace curl {
+
+/**
+ * Event loop driving a multi handle through curl_multi_socket_action using
+ * epoll and a timerfd.
+ *
+ * Sockets are registered with the interest given by the socket event, and
+ * the timer event arms a timerfd that is part of the same epoll set, so
+ * each wakeup only costs work proportional to the number of ready sockets.
+ * Interest is level triggered, as libcurl may leave a socket writable
+ * without filling it, such as when an upload is read in small pieces.
+ *
+ * example usage:
+ * @code
+ *   auto m    = curl::multi();
+ *   curl::epoll_loop loop(m);
+ *   m.add_handle(e);
+ *   while (loop.pending()) {
+ *     loop.run_once();
+ *     for (auto msg : m.info_read()) { ... }
+ *   }
+ * @endcode
+ *
+ * @warning installs itself as the socket and timer handler of the multi
+ * handle, which must outlive the loop.
+ */
+struct epoll_loop {
+	/**
+	 * Create epoll and timer descriptors and install handlers on m.
+	 *
+	 * @param max_events maximum number of events handled per wakeup.
+	 * @throws std::system_error on failure to create descriptors.
+	 */
+	explicit epoll_loop(multi_ref m, size_t max_events = 256)
+	: _multi(m)
+	, _events(max_events)
+	{
+		_epoll = ::epoll_create1(EPOLL_CLOEXEC);
+		if (_epoll == -1) {
+			throw std::system_error(errno, std::generic_category(),
+			                        "epoll_create1");
+		}
+		_timer = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+		if (_timer == -1) {
+			auto e = errno;
+			::close(_epoll);
+			throw std::system_error(e, std::generic_category(),
+			                        "timerfd_create");
+		}
+		_wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+		if (_wake == -1) {
+			auto e = errno;
+			::close(_timer);
+			::close(_epoll);
+			throw std::system_error(e, std::generic_category(),
+			                        "eventfd");
+		}
+		for (auto fd : { _timer, _wake }) {
+			epoll_event ev{};
+			ev.events  = EPOLLIN;
+			ev.data.fd = fd;
+			if (::epoll_ctl(_epoll, EPOLL_CTL_ADD, fd, &ev) == -1) {
+				auto e = errno;
+				::close(_wake);
+				::close(_timer);
+				::close(_epoll);
+				throw std::system_error(e, std::generic_category(),
+				                        "epoll_ctl");
+			}
+		}
+		_multi.set_handler<multi_ref::socket>(this);
+		_multi.set_handler<multi_ref::timer>(this);
+	}
+
+	epoll_loop(epoll_loop const&) = delete;
+	auto operator=(epoll_loop const&) -> epoll_loop& = delete;
+
+	/**
+	 * Uninstall handlers and close descriptors.
+	 */
+	~epoll_loop() noexcept
+	{
+		::curl_multi_setopt(_multi.raw(), CURLMOPT_SOCKETFUNCTION, nullptr);
+		::curl_multi_setopt(_multi.raw(), CURLMOPT_SOCKETDATA, nullptr);
+		::curl_multi_setopt(_multi.raw(), CURLMOPT_TIMERFUNCTION, nullptr);
+		::curl_multi_setopt(_multi.raw(), CURLMOPT_TIMERDATA, nullptr);
+		::close(_wake);
+		::close(_timer);
+		::close(_epoll);
+	}
+
+	/**
+	 * Wait up to timeout for activity and pass ready sockets and expired
+	 * timers to socket_action.
+	 * A negative timeout waits indefinitely.
+	 *
+	 * @returns number of running easy handles.
+	 * @throws curl::mcode
+	 * @throws std::system_error
+	 */
+	auto run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1))
+		-> int
+	{
+		auto n = ::epoll_wait(_epoll, _events.data(),
+		                      static_cast<int>(_events.size()),
+		                      static_cast<int>(timeout.count()));
+		if (n == -1) {
+			if (errno == EINTR) {
+				return _running;
+			}
+			throw std::system_error(errno, std::generic_category(),
+			                        "epoll_wait");
+		}
+		for (int i = 0; i < n; ++i) {
+			auto const& ev = _events[i];
+			if (ev.data.fd == _timer) {
+				uint64_t expirations;
+				(void)::read(_timer, &expirations, sizeof expirations);
+				_timer_armed = false;
+				_running = _multi.socket_action(CURL_SOCKET_TIMEOUT, 0);
+			} else if (ev.data.fd == _wake) {
+				uint64_t count;
+				(void)::read(_wake, &count, sizeof count);
+			} else {
+				_running = _multi.socket_action(ev.data.fd, to_mask(ev.events));
+			}
+		}
+		return _running;
+	}
+
+	/**
+	 * Run until there are no running transfers or pending timeouts.
+	 *
+	 * @throws curl::mcode
+	 * @throws std::system_error
+	 */
+	void run()
+	{
+		while (pending()) {
+			run_once();
+		}
+	}
+
+	/**
+	 * Makes a blocked or the next call to run_once return early.
+	 * Safe to call from any thread.
+	 */
+	void wakeup() noexcept
+	{
+		uint64_t one = 1;
+		(void)::write(_wake, &one, sizeof one);
+	}
+
+	/**
+	 * @returns true iff there are running transfers or a pending timeout.
+	 */
+	auto pending() const noexcept -> bool
+	{
+		return _running > 0 || _timer_armed;
+	}
+
+	/**
+	 * @returns number of running easy handles as of the last action.
+	 */
+	auto running() const noexcept -> int
+	{
+		return _running;
+	}
+
+	/**
+	 * Updates epoll interest for the socket.
+	 */
+	int on(multi_ref::socket s) noexcept
+	{
+		if (s.what == multi_ref::socket::remove) {
+			// socket may already be closed, which removes it anyway.
+			::epoll_ctl(_epoll, EPOLL_CTL_DEL, s.sock, nullptr);
+			return 0;
+		}
+		epoll_event ev{};
+		ev.events  = 0;
+		ev.events |= (s.what & multi_ref::socket::in)  ? EPOLLIN  : 0u;
+		ev.events |= (s.what & multi_ref::socket::out) ? EPOLLOUT : 0u;
+		ev.data.fd = s.sock;
+		// socketp is only set once the socket has been added.
+		auto op = s.data ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+		if (::epoll_ctl(_epoll, op, s.sock, &ev) == -1) {
+			op = errno == EEXIST ? EPOLL_CTL_MOD
+			   : errno == ENOENT ? EPOLL_CTL_ADD
+			   : -1;
+			if (op == -1 || ::epoll_ctl(_epoll, op, s.sock, &ev) == -1) {
+				return -1;
+			}
+		}
+		if (s.data == nullptr) {
+			::curl_multi_assign(_multi.raw(), s.sock, this);
+		}
+		return 0;
+	}
+
+	/**
+	 * Arms or disarms the timerfd.
+	 */
+	int on(multi_ref::timer t) noexcept
+	{
+		itimerspec its{};
+		auto ms = t.timeout.count();
+		if (ms == 0) {
+			// expire as soon as possible, but never from within the
+			// callback.
+			its.it_value.tv_nsec = 1;
+		} else if (ms > 0) {
+			its.it_value.tv_sec  = ms / 1000;
+			its.it_value.tv_nsec = (ms % 1000) * 1000000;
+		}
+		_timer_armed = ms >= 0;
+		return ::timerfd_settime(_timer, 0, &its, nullptr) == -1 ? -1 : 0;
+	}
+
+private:
+	static auto to_mask(uint32_t events) noexcept -> int
+	{
+		int mask = 0;
+		mask |= (events & EPOLLIN)  ? CURL_CSELECT_IN  : 0;
+		mask |= (events & EPOLLOUT) ? CURL_CSELECT_OUT : 0;
+		mask |= (events & (EPOLLERR | EPOLLHUP)) ? CURL_CSELECT_ERR : 0;
+		return mask;
+	}
+
+	multi_ref                _multi;
+	std::vector<epoll_event> _events;
+	int                      _epoll       = -1;
+	int                      _timer       = -1;
+	int                      _wake        = -1;
+	int                      _running     = 0;
+	bool                     _timer_armed = false;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_EPOLL_LOOP_HPP
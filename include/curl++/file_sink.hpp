@@ -0,0 +1,489 @@
+#ifndef CURLPLUSPLUS_FILE_SINK_HPP
+#define CURLPLUSPLUS_FILE_SINK_HPP
+#include "buffer.hpp"
+#include "easy.hpp"
+#include "header_line.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <system_error>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace curl {
+
+/**
+ * Writes a response body into a file through a shared memory mapping.
+ *
+ * When the response carries Content-Length the file is sized and mapped
+ * once, and every write event is a memcpy into the mapping. Otherwise the
+ * mapping grows by doubling. finish() trims the file to the bytes received.
+ *
+ * example usage:
+ * @code
+ *   struct download : curl::easy_base<download> {
+ *     curl::mmap_sink file{"out.bin"};
+ *     auto on(header h) noexcept -> size_t { return file.on(h); }
+ *     auto on(write w) noexcept -> size_t { return file.on(w); }
+ *   };
+ *   d.perform();
+ *   d.file.finish();
+ * @endcode
+ */
+struct mmap_sink {
+	/**
+	 * Create or truncate the file at path.
+	 *
+	 * @throws std::system_error
+	 */
+	explicit mmap_sink(const char* path, mode_t mode = 0644)
+	: _fd(::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, mode))
+	{
+		if (_fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "open");
+		}
+	}
+
+	mmap_sink(mmap_sink const&) = delete;
+	auto operator=(mmap_sink const&) -> mmap_sink& = delete;
+
+	/**
+	 * Finish the file, ignoring errors, and close it.
+	 */
+	~mmap_sink() noexcept
+	{
+		unmap();
+		::close(_fd);
+	}
+
+	/**
+	 * Look for the status line and Content-Length, for use as a handler of
+	 * header events.
+	 */
+	auto on(easy_ref::header h) noexcept -> size_t
+	{
+		if (detail::is_status_line(h)) {
+			_written  = 0;
+			_expected = detail::unknown_length;
+		} else {
+			auto n = detail::content_length(h);
+			if (n != detail::unknown_length) {
+				_expected = n;
+			}
+		}
+		return h.size();
+	}
+
+	/**
+	 * Copy the received data into the mapping, for use as a handler of
+	 * write events.
+	 *
+	 * @returns 0 to fail the transfer if the file could not be grown.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		auto need = _written + w.size();
+		if (need > _mapped && !grow(need)) {
+			return 0;
+		}
+		std::memcpy(_map + _written, w.data(), w.size());
+		_written = need;
+		return w.size();
+	}
+
+	/**
+	 * Unmap the file and trim it to the bytes received.
+	 *
+	 * @throws std::system_error
+	 */
+	void finish()
+	{
+		if (!unmap()) {
+			throw std::system_error(_error, std::generic_category(), "ftruncate");
+		}
+	}
+
+	/**
+	 * @returns number of bytes written.
+	 */
+	auto written() const noexcept -> size_t
+	{
+		return _written;
+	}
+
+	/**
+	 * @returns errno of the last failure, or 0.
+	 */
+	auto error() const noexcept -> int
+	{
+		return _error;
+	}
+
+private:
+	auto grow(size_t need) noexcept -> bool
+	{
+		constexpr auto min_map = size_t(1024 * 1024);
+		auto size = std::max(need, std::max(_mapped * 2, min_map));
+		if (_mapped == 0 && _expected != detail::unknown_length && _expected >= need) {
+			size = _expected;
+		}
+		if (::ftruncate(_fd, static_cast<off_t>(size)) != 0) {
+			_error = errno;
+			return false;
+		}
+		auto p = _map == nullptr
+			? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0)
+			: ::mremap(_map, _mapped, size, MREMAP_MAYMOVE);
+		if (p == MAP_FAILED) {
+			_error = errno;
+			return false;
+		}
+		_map    = static_cast<char*>(p);
+		_mapped = size;
+		return true;
+	}
+
+	auto unmap() noexcept -> bool
+	{
+		if (_map != nullptr) {
+			::munmap(_map, _mapped);
+			_map = nullptr;
+		}
+		auto ok = true;
+		if (_mapped != _written && ::ftruncate(_fd, static_cast<off_t>(_written)) != 0) {
+			_error = errno;
+			ok = false;
+		}
+		_mapped = 0;
+		return ok;
+	}
+
+	int    _fd;
+	char*  _map      = nullptr;
+	size_t _mapped   = 0;
+	size_t _written  = 0;
+	size_t _expected = detail::unknown_length;
+	int    _error    = 0;
+};
+
+/**
+ * Writes a response body into a file with pwritev, gathering write events
+ * into aligned blocks so each system call writes many of them at once.
+ *
+ * With O_DIRECT the blocks bypass the page cache. The final partial block
+ * cannot be written that way, so O_DIRECT is turned off for it.
+ *
+ * A sink may write into part of a file shared with other sinks, starting
+ * at a given offset, such as for downloading byte ranges in parallel.
+ *
+ * example usage:
+ * @code
+ *   curl::pwrite_sink file("out.bin");
+ *   e.set_handler<curl::easy_ref::write>(&file);
+ *   e.perform();
+ *   file.finish();
+ * @endcode
+ */
+struct pwrite_sink {
+	struct options {
+		size_t coalesce  = 1024 * 1024; // bytes gathered per write.
+		size_t block     = 64 * 1024;   // size of each staging block.
+		bool   direct    = false;       // bypass the page cache.
+		size_t alignment = 4096;        // O_DIRECT alignment, a power of two.
+	};
+
+	/**
+	 * Create or truncate the file at path.
+	 *
+	 * @throws std::system_error
+	 */
+	explicit pwrite_sink(const char* path)
+	: pwrite_sink(path, options())
+	{}
+
+	/**
+	 * Create or truncate the file at path.
+	 * O_DIRECT is used only if the file system supports it.
+	 *
+	 * @throws std::system_error, with EINVAL if options::alignment is not
+	 *         a power of two.
+	 * @throws std::bad_alloc
+	 */
+	pwrite_sink(const char* path, options o)
+	: _options(o)
+	{
+		check(o);
+		auto flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+		_fd = ::open(path, flags | (o.direct ? O_DIRECT : 0), 0644);
+		if (_fd < 0 && o.direct && errno == EINVAL) {
+			_fd = ::open(path, flags, 0644);
+			_options.direct = false;
+		}
+		if (_fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "open");
+		}
+		_owned = true;
+		try {
+			init();
+		} catch (std::bad_alloc const&) {
+			::close(_fd);
+			throw;
+		}
+	}
+
+	/**
+	 * Write into fd starting at offset. fd is not closed by the sink, and
+	 * its flags are left alone, so options::direct is ignored.
+	 *
+	 * @throws std::system_error, with EINVAL if options::alignment is not
+	 *         a power of two.
+	 * @throws std::bad_alloc
+	 */
+	pwrite_sink(int fd, off_t offset, options o)
+	: _options(o)
+	, _fd(fd)
+	, _offset(offset)
+	{
+		check(o);
+		_options.direct = false;
+		init();
+	}
+
+	pwrite_sink(pwrite_sink const&) = delete;
+	auto operator=(pwrite_sink const&) -> pwrite_sink& = delete;
+
+	/**
+	 * Write out what is left, ignoring errors, and close the file if owned.
+	 */
+	~pwrite_sink() noexcept
+	{
+		flush_all();
+		for (auto b : _blocks) {
+			std::free(b);
+		}
+		if (_owned) {
+			::close(_fd);
+		}
+	}
+
+	/**
+	 * Copy the received data into the staging blocks, writing them out once
+	 * enough has been gathered. For use as a handler of write events.
+	 *
+	 * @returns 0 to fail the transfer if writing failed.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		auto p = w.data();
+		auto n = w.size();
+		while (n > 0) {
+			auto b = _staged / _options.block;
+			auto used = _staged % _options.block;
+			auto k = std::min(n, _options.block - used);
+			std::memcpy(_blocks[b] + used, p, k);
+			_staged += k;
+			p += k;
+			n -= k;
+			if (_staged == _capacity && !flush(_staged)) {
+				return 0;
+			}
+		}
+		return w.size();
+	}
+
+	/**
+	 * Write out everything staged.
+	 *
+	 * @throws std::system_error
+	 */
+	void finish()
+	{
+		if (!flush_all()) {
+			throw std::system_error(_error, std::generic_category(), "pwritev");
+		}
+	}
+
+	/**
+	 * @returns number of bytes written to the file so far.
+	 */
+	auto written() const noexcept -> size_t
+	{
+		return _written;
+	}
+
+	/**
+	 * @returns errno of the last failure, or 0.
+	 */
+	auto error() const noexcept -> int
+	{
+		return _error;
+	}
+
+	/**
+	 * @returns true iff blocks are written with O_DIRECT.
+	 */
+	auto direct() const noexcept -> bool
+	{
+		return _options.direct;
+	}
+
+private:
+	/**
+	 * @throws std::system_error
+	 */
+	static void check(options const& o)
+	{
+		if (o.alignment == 0 || (o.alignment & (o.alignment - 1)) != 0) {
+			throw std::system_error(EINVAL, std::generic_category(),
+			                        "pwrite_sink alignment");
+		}
+	}
+
+	/**
+	 * @throws std::bad_alloc
+	 */
+	void init()
+	{
+		// posix_memalign takes no less.
+		_options.alignment = std::max(_options.alignment, sizeof(void*));
+		if (_options.block == 0 || _options.block % _options.alignment != 0
+		 || _offset % static_cast<off_t>(_options.alignment) != 0) {
+			set_direct(false);
+		}
+		if (_options.block == 0) {
+			_options.block = 64 * 1024;
+		}
+		auto count = std::max<size_t>(1, _options.coalesce / _options.block);
+		count = std::min<size_t>(count, IOV_MAX);
+		_capacity = count * _options.block;
+		_blocks.reserve(count);
+		_iov.reserve(count);
+		for (size_t i = 0; i < count; ++i) {
+			void* b = nullptr;
+			if (::posix_memalign(&b, _options.alignment, _options.block) != 0) {
+				for (auto x : _blocks) {
+					std::free(x);
+				}
+				_blocks.clear();
+				throw std::bad_alloc();
+			}
+			_blocks.push_back(static_cast<char*>(b));
+		}
+	}
+
+	/**
+	 * Write the first n staged bytes, then move the rest to the front.
+	 */
+	auto flush(size_t n) noexcept -> bool
+	{
+		_iov.clear();
+		for (size_t i = 0; i * _options.block < n; ++i) {
+			auto len = std::min(_options.block, n - i * _options.block);
+			_iov.push_back({ _blocks[i], len });
+		}
+		auto v = _iov.data();
+		auto count = static_cast<int>(_iov.size());
+		auto left = n;
+		while (left > 0) {
+			auto r = ::pwritev(_fd, v, count, _offset);
+			if (r < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				_error = errno;
+				return false;
+			}
+			if (r == 0) {
+				// would never make progress.
+				_error = EIO;
+				return false;
+			}
+			auto done = static_cast<size_t>(r);
+			_offset  += r;
+			_written += done;
+			left     -= done;
+			while (count > 0 && done >= v->iov_len) {
+				done -= v->iov_len;
+				++v;
+				--count;
+			}
+			if (count > 0) {
+				v->iov_base = static_cast<char*>(v->iov_base) + done;
+				v->iov_len -= done;
+			}
+			if (_options.direct && r % static_cast<ssize_t>(_options.alignment) != 0) {
+				// the rest is no longer aligned for O_DIRECT.
+				set_direct(false);
+			}
+		}
+		// keep the unwritten tail of a partial flush at the front.
+		auto rest = _staged - n;
+		for (size_t i = 0; i < rest; ) {
+			auto from = n + i;
+			auto k = std::min({ rest - i,
+			                    _options.block - from % _options.block,
+			                    _options.block - i % _options.block });
+			std::memmove(_blocks[i / _options.block] + i % _options.block,
+			             _blocks[from / _options.block] + from % _options.block, k);
+			i += k;
+		}
+		_staged = rest;
+		return true;
+	}
+
+	/**
+	 * Write whole aligned blocks as is, then the tail without O_DIRECT.
+	 */
+	auto flush_all() noexcept -> bool
+	{
+		if (_staged == 0) {
+			return true;
+		}
+		if (_options.direct) {
+			auto aligned = _staged - _staged % _options.alignment;
+			if (aligned > 0 && !flush(aligned)) {
+				return false;
+			}
+			if (_staged > 0) {
+				set_direct(false);
+			}
+		}
+		return _staged == 0 || flush(_staged);
+	}
+
+	void set_direct(bool on) noexcept
+	{
+		if (_options.direct && !on) {
+			auto flags = ::fcntl(_fd, F_GETFL);
+			if (flags >= 0) {
+				::fcntl(_fd, F_SETFL, flags & ~O_DIRECT);
+			}
+		}
+		_options.direct = on;
+	}
+
+	options              _options;
+	int                  _fd     = -1;
+	bool                 _owned  = false;
+	off_t                _offset = 0;
+	std::vector<char*>   _blocks;
+	std::vector<::iovec> _iov; // reserved for every block.
+	size_t               _capacity = 0;
+	size_t               _staged   = 0;
+	size_t               _written  = 0;
+	int                  _error    = 0;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_FILE_SINK_HPP
@@ -0,0 +1,127 @@
+#ifndef CURLPLUSPLUS_FIXED_SINK_HPP
+#define CURLPLUSPLUS_FIXED_SINK_HPP
+#include "buffer.hpp"
+#include "easy.hpp"
+#include "types.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <curl/curl.h>
+
+namespace curl {
+
+/**
+ * Writes a response body straight into a buffer owned by the caller, such
+ * as a slot of a shared memory ring.
+ *
+ * A response that does not fit fails the transfer rather than being cut
+ * short. When the server announces its length, CURLOPT_MAXFILESIZE_LARGE
+ * makes libcurl fail before any of the body is received.
+ *
+ * example usage:
+ * @code
+ *   curl::fixed_sink sink({ slot, slot_size });
+ *   sink.attach(e);
+ *   try {
+ *     e.perform();
+ *     publish(slot, sink.filled());
+ *   } catch (curl::code const& c) {
+ *     fail(sink.result(c));
+ *   }
+ * @endcode
+ */
+struct fixed_sink {
+	/**
+	 * @param dest buffer the body is written to.
+	 */
+	explicit fixed_sink(mutable_buffer dest) noexcept
+	: _dest(dest)
+	{}
+
+	fixed_sink(fixed_sink const&) = delete;
+	auto operator=(fixed_sink const&) -> fixed_sink& = delete;
+
+	/**
+	 * Write the body of e into the buffer, and limit its size to the size
+	 * of the buffer.
+	 *
+	 * @throws curl::code
+	 */
+	void attach(easy_ref e)
+	{
+		e.set_handler<easy_ref::write>(this);
+		e.setopt(CURLOPT_MAXFILESIZE_LARGE, static_cast<curl_off_t>(_dest.size()));
+	}
+
+	/**
+	 * Start over with a new buffer, for reusing the sink.
+	 * Call attach() again if the size of the buffer changed.
+	 */
+	void reset(mutable_buffer dest) noexcept
+	{
+		_dest     = dest;
+		_filled   = 0;
+		_overflow = false;
+	}
+
+	/**
+	 * Copy the received data into the buffer, for use as a handler of
+	 * write events.
+	 *
+	 * @returns 0 to fail the transfer if the data does not fit.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		if (w.size() > _dest.size() - _filled) {
+			_overflow = true;
+			return 0;
+		}
+		std::memcpy(_dest.data() + _filled, w.data(), w.size());
+		_filled += w.size();
+		return w.size();
+	}
+
+	/**
+	 * @returns number of bytes written into the buffer.
+	 */
+	auto filled() const noexcept -> size_t
+	{
+		return _filled;
+	}
+
+	/**
+	 * @returns the filled part of the buffer.
+	 */
+	auto data() const noexcept -> mutable_buffer
+	{
+		return { _dest.data(), _filled };
+	}
+
+	/**
+	 * @returns true iff the body did not fit in the buffer.
+	 */
+	auto overflowed() const noexcept -> bool
+	{
+		return _overflow;
+	}
+
+	/**
+	 * @returns the result of a transfer, with the write error caused by an
+	 *          overflow reported as CURLE_FILESIZE_EXCEEDED.
+	 */
+	auto result(code c) const noexcept -> code
+	{
+		if (_overflow && c == CURLE_WRITE_ERROR) {
+			return CURLE_FILESIZE_EXCEEDED;
+		}
+		return c;
+	}
+
+private:
+	mutable_buffer _dest;
+	size_t         _filled   = 0;
+	bool           _overflow = false;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_FIXED_SINK_HPP
@@ -27,7 +27,7 @@ struct global {
 	 */
 	explicit global(flags f = DEFAULT)
 	{
-		invoke(::curl_global_init, f);
+		curl::invoke(::curl_global_init, f);
 	}
 
 	/**
@@ -31,7 +31,7 @@ public:
 	/**
 	 * Returns raw handle.
 	 */
-	auto raw() -> Handle
+	auto raw() const noexcept -> Handle
 	{
 		return _handle;
 	}
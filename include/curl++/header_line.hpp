@@ -0,0 +1,113 @@
+#ifndef CURLPLUSPLUS_HEADER_LINE_HPP
+#define CURLPLUSPLUS_HEADER_LINE_HPP
+#include "buffer.hpp"
+
+#include <cctype>
+#include <cstddef>
+#include <cstring>
+
+namespace curl {
+namespace detail {
+
+/**
+ * Length of a response without Content-Length.
+ */
+constexpr size_t unknown_length = ~size_t(0);
+
+/**
+ * @returns true iff line is the status line starting a response.
+ */
+inline auto is_status_line(const_buffer line) noexcept -> bool
+{
+	return line.size() >= 5 && std::memcmp(line.data(), "HTTP/", 5) == 0;
+}
+
+/**
+ * @returns true iff the header line starts with name followed by a colon,
+ *          ignoring case.
+ * @param name lowercase header name.
+ */
+inline auto header_is(const_buffer line, const char* name) noexcept -> bool
+{
+	auto p = line.data();
+	auto len = std::strlen(name);
+	if (line.size() <= len || p[len] != ':') {
+		return false;
+	}
+	for (size_t i = 0; i < len; ++i) {
+		if (std::tolower(static_cast<unsigned char>(p[i])) != name[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * @returns value of a header line, without surrounding whitespace.
+ */
+inline auto header_value(const_buffer line) noexcept -> const_buffer
+{
+	auto p   = line.data();
+	auto end = p + line.size();
+	auto colon = static_cast<const char*>(std::memchr(p, ':', line.size()));
+	if (colon == nullptr) {
+		return { end, 0 };
+	}
+	p = colon + 1;
+	while (p != end && (*p == ' ' || *p == '\t')) {
+		++p;
+	}
+	while (end != p && (end[-1] == '\r' || end[-1] == '\n'
+	                 || end[-1] == ' '  || end[-1] == '\t')) {
+		--end;
+	}
+	return { p, static_cast<size_t>(end - p) };
+}
+
+/**
+ * @returns length given by the value of a Content-Length header, or
+ *          unknown_length if it is not a number that fits.
+ */
+inline auto parse_length(const_buffer v) noexcept -> size_t
+{
+	if (v.empty()) {
+		return unknown_length;
+	}
+	auto x = size_t(0);
+	for (auto c : v) {
+		if (c < '0' || c > '9') {
+			return unknown_length;
+		}
+		auto next = x * 10 + static_cast<size_t>(c - '0');
+		if (next / 10 != x) {
+			return unknown_length;
+		}
+		x = next;
+	}
+	return x;
+}
+
+/**
+ * @returns Content-Length of a response if line announces it, otherwise
+ *          unknown_length.
+ */
+inline auto content_length(const_buffer line) noexcept -> size_t
+{
+	if (!header_is(line, "content-length")) {
+		return unknown_length;
+	}
+	return parse_length(header_value(line));
+}
+
+/**
+ * @returns true iff a response with status may succeed if retried: no
+ *          response at all, a timeout, a rate limit or a server error.
+ */
+inline auto retryable_status(long status) noexcept -> bool
+{
+	return status == 0 || status == 408 || status == 429 || status >= 500;
+}
+
+} // namespace detail
+} // namespace curl
+#endif // CURLPLUSPLUS_HEADER_LINE_HPP
@@ -0,0 +1,313 @@
+#ifndef CURLPLUSPLUS_HEADER_LIST_HPP
+#define CURLPLUSPLUS_HEADER_LIST_HPP
+#include "buffer.hpp"
+#include "easy.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <curl/curl.h>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace curl {
+
+/**
+ * List of request headers for CURLOPT_HTTPHEADER, whose nodes and strings
+ * are allocated from blocks owned by the list rather than one by one as
+ * with curl_slist_append.
+ *
+ * clear() keeps the blocks, so a list rebuilt for every request made with
+ * a recycled handle stops allocating once it has grown to fit the largest
+ * one.
+ *
+ * Headers shared by many requests, such as authorization or a user agent,
+ * can be built once as a base list and linked after the headers of each
+ * request without copying them. A curl_slist can only share its tail, so
+ * the base comes last. libcurl sends the headers in list order, which for
+ * distinct header names makes no difference to the server.
+ *
+ * example usage:
+ * @code
+ *   auto common = std::make_shared<curl::header_list>();
+ *   common->append("Authorization", token);
+ *   common->append("User-Agent", "fetcher/1.0");
+ *
+ *   curl::header_list headers;
+ *   headers.base(common);
+ *   for (auto& r : requests) {
+ *     headers.clear();
+ *     headers.append("Content-Type", r.type);
+ *     headers.attach(e);
+ *     e.url(r.url);
+ *     e.perform();
+ *   }
+ * @endcode
+ *
+ * @warning libcurl reads the list while the transfer runs, so it must not
+ *          be changed or destroyed until the transfer has finished. The
+ *          same holds for a base list, which is why it is kept by a
+ *          shared_ptr and never changed once shared.
+ */
+struct header_list {
+	/**
+	 * @param block_size size of the first block, later ones doubling.
+	 */
+	explicit header_list(size_t block_size = 1024) noexcept
+	: _block_size(std::max<size_t>(block_size, 64))
+	{}
+
+	header_list(header_list&& x) noexcept
+	: _blocks(std::move(x._blocks))
+	, _block_size(x._block_size)
+	, _block(std::exchange(x._block, 0))
+	, _used(std::exchange(x._used, 0))
+	, _head(std::exchange(x._head, nullptr))
+	, _tail(std::exchange(x._tail, nullptr))
+	, _size(std::exchange(x._size, 0))
+	, _base(std::move(x._base))
+	{
+		x._blocks.clear();
+	}
+
+	auto operator=(header_list&& x) noexcept -> header_list&
+	{
+		header_list(std::move(x)).swap(*this);
+		return *this;
+	}
+
+	header_list(header_list const&) = delete;
+	auto operator=(header_list const&) -> header_list& = delete;
+
+	void swap(header_list& x) noexcept
+	{
+		using std::swap;
+		swap(_blocks, x._blocks);
+		swap(_block_size, x._block_size);
+		swap(_block, x._block);
+		swap(_used, x._used);
+		swap(_head, x._head);
+		swap(_tail, x._tail);
+		swap(_size, x._size);
+		swap(_base, x._base);
+	}
+
+	/**
+	 * Add a header line as libcurl takes it, such as "Name: value",
+	 * "Name;" to send it without a value, or "Name:" to not send a header
+	 * libcurl would add itself.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void append(const_buffer line)
+	{
+		auto s = static_cast<char*>(allocate(line.size() + 1, 1));
+		std::memcpy(s, line.data(), line.size());
+		s[line.size()] = '\0';
+		link(s);
+	}
+
+	void append(const char* line)
+	{
+		append(const_buffer{ line, std::strlen(line) });
+	}
+
+	/**
+	 * Add the header "name: value", sent without a value if it is empty.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void append(const_buffer name, const_buffer value)
+	{
+		auto n = name.size() + (value.empty() ? 1 : 2 + value.size());
+		auto s = static_cast<char*>(allocate(n + 1, 1));
+		std::memcpy(s, name.data(), name.size());
+		if (value.empty()) {
+			s[name.size()] = ';';
+		} else {
+			s[name.size()]     = ':';
+			s[name.size() + 1] = ' ';
+			std::memcpy(s + name.size() + 2, value.data(), value.size());
+		}
+		s[n] = '\0';
+		link(s);
+	}
+
+	void append(const char* name, const char* value)
+	{
+		append(const_buffer{ name, std::strlen(name) }, const_buffer{ value, std::strlen(value) });
+	}
+
+	/**
+	 * Keep libcurl from sending a header it would add itself, such as
+	 * Accept or Expect.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void remove(const char* name)
+	{
+		auto n = std::strlen(name);
+		auto s = static_cast<char*>(allocate(n + 2, 1));
+		std::memcpy(s, name, n);
+		s[n]     = ':';
+		s[n + 1] = '\0';
+		link(s);
+	}
+
+	/**
+	 * Send the headers of base after those of this list.
+	 * base must not be changed while it is shared.
+	 *
+	 * @param list to link, or nullptr for none.
+	 */
+	void base(std::shared_ptr<header_list const> list) noexcept
+	{
+		_base = std::move(list);
+		relink();
+	}
+
+	auto base() const noexcept -> std::shared_ptr<header_list const> const&
+	{
+		return _base;
+	}
+
+	/**
+	 * Drop the headers of this list, keeping its memory and base for the
+	 * next request.
+	 */
+	void clear() noexcept
+	{
+		_block = 0;
+		_used  = 0;
+		_head  = nullptr;
+		_tail  = nullptr;
+		_size  = 0;
+		relink();
+	}
+
+	/**
+	 * Send the list with the requests of e, as CURLOPT_HTTPHEADER unless
+	 * another option such as CURLOPT_PROXYHEADER is given.
+	 *
+	 * @throws curl::code
+	 */
+	void attach(easy_ref e, CURLoption o = CURLOPT_HTTPHEADER) const
+	{
+		e.setopt(o, get());
+	}
+
+	/**
+	 * @returns the list, including the base, or nullptr if both are empty.
+	 */
+	auto get() const noexcept -> curl_slist*
+	{
+		return _head != nullptr ? _head : base_head();
+	}
+
+	/**
+	 * @returns number of headers in this list, not counting the base.
+	 */
+	auto size() const noexcept -> size_t
+	{
+		return _size;
+	}
+
+	auto empty() const noexcept -> bool
+	{
+		return _size == 0;
+	}
+
+	/**
+	 * @returns bytes of memory held by the list.
+	 */
+	auto capacity() const noexcept -> size_t
+	{
+		auto n = size_t(0);
+		for (auto& b : _blocks) {
+			n += b.size;
+		}
+		return n;
+	}
+
+private:
+	struct block {
+		std::unique_ptr<char[]> data;
+		size_t                  size;
+	};
+
+	auto base_head() const noexcept -> curl_slist*
+	{
+		return _base ? _base->get() : nullptr;
+	}
+
+	/**
+	 * Point the last node at the current base.
+	 */
+	void relink() noexcept
+	{
+		if (_tail != nullptr) {
+			_tail->next = base_head();
+		}
+	}
+
+	/**
+	 * Add a node for s, which libcurl takes as char* though it does not
+	 * change it.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void link(char* s)
+	{
+		auto node = static_cast<curl_slist*>(allocate(sizeof(curl_slist), alignof(curl_slist)));
+		node->data = s;
+		node->next = base_head();
+		if (_tail != nullptr) {
+			_tail->next = node;
+		} else {
+			_head = node;
+		}
+		_tail = node;
+		++_size;
+	}
+
+	/**
+	 * @returns n bytes aligned to align from the blocks, moving on to the
+	 *          next one, or adding one, if the current block is too full.
+	 * @throws std::bad_alloc
+	 */
+	auto allocate(size_t n, size_t align) -> void*
+	{
+		while (_block < _blocks.size()) {
+			auto& b = _blocks[_block];
+			auto start = reinterpret_cast<uintptr_t>(b.data.get());
+			auto at = ((start + _used + align - 1) & ~uintptr_t(align - 1)) - start;
+			if (at + n <= b.size) {
+				_used = at + n;
+				return b.data.get() + at;
+			}
+			++_block;
+			_used = 0;
+		}
+		auto size = _blocks.empty() ? _block_size : _blocks.back().size * 2;
+		size = std::max(size, n + align);
+		_blocks.push_back({ std::unique_ptr<char[]>(new char[size]), size });
+		_block = _blocks.size() - 1;
+		_used  = 0;
+		return allocate(n, align);
+	}
+
+	std::vector<block>                 _blocks;
+	size_t                             _block_size;
+	size_t                             _block = 0;
+	size_t                             _used  = 0;
+	curl_slist*                        _head  = nullptr;
+	curl_slist*                        _tail  = nullptr;
+	size_t                             _size  = 0;
+	std::shared_ptr<header_list const> _base;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_HEADER_LIST_HPP
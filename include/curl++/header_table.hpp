@@ -0,0 +1,426 @@
+#ifndef CURLPLUSPLUS_HEADER_TABLE_HPP
+#define CURLPLUSPLUS_HEADER_TABLE_HPP
+#include "buffer.hpp"
+#include "easy.hpp"
+#include "header_line.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace curl {
+namespace detail {
+
+#if defined(__SSE2__)
+/**
+ * @returns the 16 bytes of v with ASCII letters in lowercase.
+ */
+inline auto ascii_lower16(__m128i v) noexcept -> __m128i
+{
+	// bytes of 0x80 and above compare as negative, so are left alone.
+	auto upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+	                           _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+	return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+#endif
+
+inline auto ascii_lower(char c) noexcept -> char
+{
+	return c >= 'A' && c <= 'Z' ? static_cast<char>(c | 0x20) : c;
+}
+
+/**
+ * Copy n bytes from src to dst with ASCII letters in lowercase.
+ */
+inline void ascii_lower(char* dst, const char* src, size_t n) noexcept
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	for (; i + 16 <= n; i += 16) {
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), ascii_lower16(v));
+	}
+#endif
+	for (; i < n; ++i) {
+		dst[i] = ascii_lower(src[i]);
+	}
+}
+
+/**
+ * @returns true iff the n bytes of s equal those of lower, ignoring the
+ *          case of ASCII letters in s.
+ * @param lower bytes with ASCII letters in lowercase.
+ */
+inline auto equal_lower(const char* lower, const char* s, size_t n) noexcept -> bool
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	for (; i + 16 <= n; i += 16) {
+		auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lower + i));
+		auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+		if (_mm_movemask_epi8(_mm_cmpeq_epi8(a, ascii_lower16(b))) != 0xffff) {
+			return false;
+		}
+	}
+#endif
+	for (; i < n; ++i) {
+		if (lower[i] != ascii_lower(s[i])) {
+			return false;
+		}
+	}
+	return true;
+}
+
+} // namespace detail
+
+/**
+ * The headers of a response, collected from its header events, without
+ * allocating once the table has grown to fit the largest response.
+ *
+ * Names and values are copied into one buffer, with names in lowercase,
+ * and looked up ignoring case. The buffer and index are kept between
+ * responses, so a table reused for every transfer of a handle allocates
+ * only while warming up.
+ *
+ * Every status line starts over, so after a redirect or an interim 1xx
+ * response the table holds the final response. Trailers are added after
+ * the headers. Values spread over folded lines are joined with a space.
+ *
+ * Buffers returned by the table point into it, and are valid until the
+ * next header event or reset().
+ *
+ * example usage:
+ * @code
+ *   struct request : curl::easy_base<request> {
+ *     curl::header_table headers;
+ *     auto on(header h) noexcept -> size_t { return headers.on(h); }
+ *   };
+ *   r.perform();
+ *   if (r.headers.status() == 200) {
+ *     auto type = r.headers.get("content-type");
+ *   }
+ * @endcode
+ */
+struct header_table {
+	/**
+	 * A header of the response.
+	 */
+	struct field {
+		const_buffer name;  // in lowercase.
+		const_buffer value; // without surrounding whitespace.
+	};
+
+	/**
+	 * @param reserve bytes of names and values to make room for up front.
+	 * @throws std::bad_alloc
+	 */
+	explicit header_table(size_t reserve = 4096)
+	{
+		_text.reserve(reserve);
+		_fields.reserve(32);
+	}
+
+	/**
+	 * Add a header line, or start over at a status line, for use as a
+	 * handler of header events.
+	 *
+	 * @returns 0 to fail the transfer if out of memory.
+	 */
+	auto on(easy_ref::header h) noexcept -> size_t
+	{
+		try {
+			add(h);
+			return h.size();
+		} catch (std::bad_alloc const&) {
+			return 0;
+		}
+	}
+
+	/**
+	 * Add a header line, or start over at a status line.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void add(const_buffer line)
+	{
+		if (detail::is_status_line(line)) {
+			start(line);
+			return;
+		}
+		auto v = trim(line.data(), line.data() + line.size());
+		if (v.empty()) {
+			_complete = true;
+			return;
+		}
+		if ((line[0] == ' ' || line[0] == '\t') && !_fields.empty()) {
+			fold(v);
+			return;
+		}
+		auto colon = static_cast<const char*>(std::memchr(line.data(), ':', line.size()));
+		if (colon == nullptr || colon == line.data()) {
+			// not a header, so nothing to look up.
+			return;
+		}
+		auto n = static_cast<size_t>(colon - line.data());
+		auto value = detail::header_value(line);
+		auto at = _text.size();
+		_text.resize(at + n + value.size());
+		detail::ascii_lower(&_text[at], line.data(), n);
+		std::memcpy(&_text[at + n], value.data(), value.size());
+		_fields.push_back({ key(&_text[at], n), uint32_t(at), uint32_t(n), uint32_t(value.size()) });
+	}
+
+	/**
+	 * Drop all headers, keeping the memory for the next response.
+	 */
+	void reset() noexcept
+	{
+		_text.clear();
+		_fields.clear();
+		_status_line.clear();
+		_status    = 0;
+		_version   = 0;
+		_reason    = 0;
+		_complete  = false;
+		_responses = 0;
+	}
+
+	/**
+	 * @returns value of the first header called name, ignoring case, or
+	 *          an empty buffer if there is none.
+	 */
+	auto get(const_buffer name) const noexcept -> const_buffer
+	{
+		auto i = find(name, 0);
+		return i < _fields.size() ? value(_fields[i]) : const_buffer{ nullptr, 0 };
+	}
+
+	auto get(const char* name) const noexcept -> const_buffer
+	{
+		return get(const_buffer{ name, std::strlen(name) });
+	}
+
+	/**
+	 * @returns true iff there is a header called name, ignoring case.
+	 */
+	auto has(const_buffer name) const noexcept -> bool
+	{
+		return find(name, 0) < _fields.size();
+	}
+
+	auto has(const char* name) const noexcept -> bool
+	{
+		return has(const_buffer{ name, std::strlen(name) });
+	}
+
+	/**
+	 * @returns index of the first header called name, ignoring case, at
+	 *          or after index from, or size() if there is none.
+	 */
+	auto find(const_buffer name, size_t from) const noexcept -> size_t
+	{
+		if (name.empty()) {
+			return _fields.size();
+		}
+		auto k = key(name.data(), name.size());
+		for (auto i = from; i < _fields.size(); ++i) {
+			auto& f = _fields[i];
+			if (f.key == k && f.name_size == name.size()
+			 && detail::equal_lower(&_text[f.offset], name.data(), name.size())) {
+				return i;
+			}
+		}
+		return _fields.size();
+	}
+
+	auto find(const char* name, size_t from = 0) const noexcept -> size_t
+	{
+		return find(const_buffer{ name, std::strlen(name) }, from);
+	}
+
+	/**
+	 * @returns header i, in the order received.
+	 */
+	auto operator[](size_t i) const noexcept -> field
+	{
+		auto& f = _fields[i];
+		return { { &_text[f.offset], f.name_size }, value(f) };
+	}
+
+	/**
+	 * @returns number of headers.
+	 */
+	auto size() const noexcept -> size_t
+	{
+		return _fields.size();
+	}
+
+	auto empty() const noexcept -> bool
+	{
+		return _fields.empty();
+	}
+
+	/**
+	 * @returns Content-Length of the response, or detail::unknown_length.
+	 */
+	auto content_length() const noexcept -> size_t
+	{
+		return detail::parse_length(get("content-length"));
+	}
+
+	/**
+	 * @returns status code of the response, or 0 before its status line.
+	 */
+	auto status() const noexcept -> long
+	{
+		return _status;
+	}
+
+	/**
+	 * @returns HTTP version of the response as major * 10 + minor, such
+	 *          as 11 or 20, or 0 before its status line.
+	 */
+	auto version() const noexcept -> int
+	{
+		return _version;
+	}
+
+	/**
+	 * @returns reason phrase of the status line, which HTTP/2 and later
+	 *          do not have.
+	 */
+	auto reason() const noexcept -> const_buffer
+	{
+		return { _status_line.data() + _reason, _status_line.size() - _reason };
+	}
+
+	/**
+	 * @returns true iff the headers of the response have ended.
+	 */
+	auto complete() const noexcept -> bool
+	{
+		return _complete;
+	}
+
+	/**
+	 * @returns number of responses seen since the last reset(), counting
+	 *          redirects and interim responses.
+	 */
+	auto responses() const noexcept -> size_t
+	{
+		return _responses;
+	}
+
+private:
+	struct entry {
+		uint32_t key;
+		uint32_t offset;
+		uint32_t name_size;
+		uint32_t value_size;
+	};
+
+	/**
+	 * @returns a cheap summary of a name, to skip most others without
+	 *          comparing them.
+	 */
+	static auto key(const char* name, size_t n) noexcept -> uint32_t
+	{
+		return uint32_t(n) << 16
+		     | uint32_t(uint8_t(detail::ascii_lower(name[0]))) << 8
+		     | uint32_t(uint8_t(detail::ascii_lower(name[n - 1])));
+	}
+
+	static auto trim(const char* p, const char* end) noexcept -> const_buffer
+	{
+		while (p != end && (*p == ' ' || *p == '\t')) {
+			++p;
+		}
+		while (end != p && (end[-1] == '\r' || end[-1] == '\n'
+		                 || end[-1] == ' '  || end[-1] == '\t')) {
+			--end;
+		}
+		return { p, static_cast<size_t>(end - p) };
+	}
+
+	auto value(entry const& f) const noexcept -> const_buffer
+	{
+		return { &_text[f.offset + f.name_size], f.value_size };
+	}
+
+	/**
+	 * Start over with the status line of another response.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void start(const_buffer line)
+	{
+		auto responses = _responses;
+		reset();
+		_responses = responses + 1;
+		auto l = trim(line.data(), line.data() + line.size());
+		_status_line.assign(l.begin(), l.end());
+		_reason = _status_line.size();
+		// HTTP/<major>[.<minor>] <code>[ <reason>]
+		auto p   = _status_line.data() + 5;
+		auto end = _status_line.data() + _status_line.size();
+		if (p == end || *p < '0' || *p > '9') {
+			return;
+		}
+		_version = (*p++ - '0') * 10;
+		if (p + 1 < end && *p == '.' && p[1] >= '0' && p[1] <= '9') {
+			_version += p[1] - '0';
+			p += 2;
+		}
+		if (end - p < 4 || *p != ' ') {
+			return;
+		}
+		auto status = 0L;
+		for (auto q = p + 1; q != p + 4; ++q) {
+			if (*q < '0' || *q > '9') {
+				return;
+			}
+			status = status * 10 + (*q - '0');
+		}
+		_status = status;
+		p += 4;
+		while (p != end && *p == ' ') {
+			++p;
+		}
+		_reason = static_cast<size_t>(p - _status_line.data());
+	}
+
+	/**
+	 * Join a folded line onto the value of the last header, which is the
+	 * last thing in the buffer.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void fold(const_buffer v)
+	{
+		auto& f = _fields.back();
+		auto at = _text.size();
+		auto space = f.value_size > 0 ? 1 : 0;
+		_text.resize(at + space + v.size());
+		_text[at] = ' ';
+		std::memcpy(&_text[at + space], v.data(), v.size());
+		f.value_size += uint32_t(space + v.size());
+	}
+
+	std::vector<char>  _text;
+	std::vector<entry> _fields;
+	std::vector<char>  _status_line;
+	long               _status    = 0;
+	int                _version   = 0;
+	size_t             _reason    = 0;
+	bool               _complete  = false;
+	size_t             _responses = 0;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_HEADER_TABLE_HPP
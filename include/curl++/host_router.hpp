@@ -0,0 +1,146 @@
+#ifndef CURLPLUSPLUS_HOST_ROUTER_HPP
+#define CURLPLUSPLUS_HOST_ROUTER_HPP
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace curl {
+
+/**
+ * Hash of the scheme, host and port of a url, which is what decides whether
+ * two transfers can share a connection.
+ *
+ * Parse once per request and keep it around rather than re-parsing the url
+ * each time it is routed.
+ */
+struct host_key {
+	uint64_t hash = 0;
+
+	/**
+	 * Hash the origin part of url, ignoring case and any user info.
+	 */
+	static auto from_url(const char* url) noexcept -> host_key
+	{
+		auto hash = offset_basis;
+		auto p = url;
+		auto scheme = std::strstr(p, "://");
+		if (scheme != nullptr) {
+			for (; p != scheme + 3; ++p) {
+				hash = mix(hash, *p);
+			}
+		}
+		auto end = p + std::strcspn(p, "/?#");
+		// skip user info.
+		for (auto q = end; q != p; --q) {
+			if (q[-1] == '@') {
+				p = q;
+				break;
+			}
+		}
+		for (; p != end; ++p) {
+			hash = mix(hash, *p);
+		}
+		return { hash };
+	}
+
+	bool operator==(host_key x) const noexcept
+	{
+		return hash == x.hash;
+	}
+
+private:
+	// FNV-1a over lowercased bytes.
+	static constexpr uint64_t offset_basis = 0xcbf29ce484222325ull;
+	static constexpr uint64_t prime        = 0x100000001b3ull;
+
+	static auto mix(uint64_t hash, char c) noexcept -> uint64_t
+	{
+		if (c >= 'A' && c <= 'Z') {
+			c = static_cast<char>(c - 'A' + 'a');
+		}
+		return (hash ^ static_cast<unsigned char>(c)) * prime;
+	}
+};
+
+/**
+ * Maps hosts onto a fixed number of shards using rendezvous hashing, so a
+ * host keeps landing on the shard that holds its warm connections.
+ *
+ * Each host ranks all shards by score. A request goes to the best ranked
+ * shard, or overflows to one of the next max_overflow shards of its ranking
+ * if the better ones are saturated. If all candidates are saturated it goes
+ * to the best ranked shard anyway.
+ */
+struct host_router {
+	/**
+	 * @param shards number of shards to route to.
+	 * @param max_overflow number of neighbours tried when saturated.
+	 */
+	explicit host_router(size_t shards, size_t max_overflow = 1) noexcept
+	: _shards(shards)
+	, _max_overflow(max_overflow)
+	{}
+
+	/**
+	 * Pick a shard for host.
+	 *
+	 * @param saturated predicate taking a shard index.
+	 */
+	template<typename Saturated>
+	auto route(host_key host, Saturated&& saturated) const -> size_t
+	{
+		auto best  = size_t(0);
+		auto floor = ~uint64_t(0);
+		auto first = true;
+		// walk the ranking from the top, one rank per pass.
+		for (size_t rank = 0; rank <= _max_overflow && rank < _shards; ++rank) {
+			auto pick  = size_t(0);
+			auto score = uint64_t(0);
+			for (size_t i = 0; i < _shards; ++i) {
+				auto s = weight(host, i);
+				if (s < floor && s >= score) {
+					pick  = i;
+					score = s;
+				}
+			}
+			if (first) {
+				best  = pick;
+				first = false;
+			}
+			if (!saturated(pick)) {
+				return pick;
+			}
+			floor = score;
+		}
+		return best;
+	}
+
+	/**
+	 * Pick the best ranked shard for host, ignoring saturation.
+	 */
+	auto route(host_key host) const noexcept -> size_t
+	{
+		return route(host, [](size_t) { return false; });
+	}
+
+	auto size() const noexcept -> size_t
+	{
+		return _shards;
+	}
+
+private:
+	static auto weight(host_key host, size_t shard) noexcept -> uint64_t
+	{
+		// splitmix64 finalizer.
+		auto x = host.hash ^ (uint64_t(shard + 1) * 0x9e3779b97f4a7c15ull);
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+		return x ^ (x >> 31);
+	}
+
+	size_t _shards;
+	size_t _max_overflow;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_HOST_ROUTER_HPP
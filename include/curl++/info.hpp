@@ -20,7 +20,7 @@ struct info {
 	 */
 	static auto getinfo(CURL* handle, CURLINFO info) -> T
 	{
-		return invoke_r<T>(::curl_easy_getinfo, handle, info);
+		return curl::invoke_r<T>(::curl_easy_getinfo, handle, info);
 	}
 };
 
@@ -28,7 +28,7 @@ template<>
 struct info<std::string> {
 	static auto getinfo(CURL* handle, CURLINFO info) -> std::string
 	{
-		return invoke_r<const char*>(::curl_easy_getinfo, handle, info);
+		return curl::invoke_r<const char*>(::curl_easy_getinfo, handle, info);
 	}
 };
 
@@ -36,7 +36,7 @@ template<>
 struct info<bool> {
 	static auto getinfo(CURL* handle, CURLINFO info) -> bool
 	{
-		return invoke_r<long>(::curl_easy_getinfo, handle, info);
+		return curl::invoke_r<long>(::curl_easy_getinfo, handle, info);
 	}
 };
 
@@ -46,7 +46,7 @@ struct info<std::chrono::duration<Rep, Period>> {
 
 	static auto getinfo(CURL* handle, CURLINFO info) -> type
 	{
-		return type(invoke_r<curl_off_t>(::curl_easy_getinfo, handle, info));
+		return type(curl::invoke_r<curl_off_t>(::curl_easy_getinfo, handle, info));
 	}
 };
 } // namespace detail
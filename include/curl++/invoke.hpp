@@ -23,7 +23,7 @@ template<typename R, typename Fn, typename... Args>
 auto invoke_r(Fn&& fn, Args&&...args) -> R
 {
 	R x;
-	invoke(std::forward<Fn>(fn), std::forward<Args>(args)..., &x);
+	curl::invoke(std::forward<Fn>(fn), std::forward<Args>(args)..., &x);
 	return x;
 }
 
@@ -0,0 +1,224 @@
+#ifndef CURLPLUSPLUS_LINE_SPLITTER_HPP
+#define CURLPLUSPLUS_LINE_SPLITTER_HPP
+#include "buffer.hpp"
+#include "easy.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace curl {
+namespace detail {
+
+/**
+ * Call f(i) with the offset i of every byte c in p[0, n), in order, until
+ * f returns false. 64 bytes are compared at a time, and the offsets are
+ * taken from the resulting bit mask, so short lines cost no more than
+ * long ones.
+ *
+ * @returns false iff f returned false.
+ */
+template<typename F>
+auto for_each_byte(const char* p, size_t n, char c, F&& f) -> bool
+{
+	size_t i = 0;
+#if defined(__SSE2__)
+	auto const needle = _mm_set1_epi8(c);
+	for (; i + 64 <= n; i += 64) {
+		uint64_t mask = 0;
+		for (int k = 0; k < 4; ++k) {
+			auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 16 * k));
+			auto m = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+			mask |= static_cast<uint64_t>(static_cast<uint16_t>(m)) << (16 * k);
+		}
+		while (mask != 0) {
+			if (!f(i + static_cast<size_t>(__builtin_ctzll(mask)))) {
+				return false;
+			}
+			mask &= mask - 1;
+		}
+	}
+#endif
+	while (i < n) {
+		auto q = static_cast<const char*>(std::memchr(p + i, c, n - i));
+		if (q == nullptr) {
+			break;
+		}
+		i = static_cast<size_t>(q - p);
+		if (!f(i)) {
+			return false;
+		}
+		++i;
+	}
+	return true;
+}
+
+} // namespace detail
+
+/**
+ * Splits a response body into lines as it is received, such as the
+ * records of newline delimited JSON.
+ *
+ * Each complete line is passed to the handler as a const_buffer without
+ * its line ending. Lines within a write event point into the received
+ * data, and only a line spanning write events is copied, into a buffer
+ * reused for the whole transfer. Empty lines are skipped.
+ *
+ * example usage:
+ * @code
+ *   struct feed : curl::easy_base<feed> {
+ *     curl::line_splitter<std::function<bool(curl::const_buffer)>> lines{
+ *       [this](curl::const_buffer record) { return parse(record); } };
+ *     auto on(write w) noexcept -> size_t { return lines.on(w); }
+ *   };
+ *   f.perform();
+ *   f.lines.finish();
+ * @endcode
+ *
+ * @param Handler callable as bool(const_buffer), returning false to stop
+ *        the transfer.
+ */
+template<typename Handler>
+struct line_splitter {
+	/**
+	 * @param handler called with every line.
+	 * @param max_line longest line kept across write events; a longer one
+	 *        fails the transfer.
+	 */
+	explicit line_splitter(Handler handler, size_t max_line = 16 * 1024 * 1024)
+	: _handler(std::move(handler))
+	, _max_line(max_line)
+	{}
+
+	/**
+	 * Pass every line completed by the received data to the handler, for
+	 * use as a handler of write events.
+	 *
+	 * @returns 0 to fail the transfer if the handler returned false or
+	 *          threw, or a line was too long.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		try {
+			return split(w) ? w.size() : 0;
+		} catch (...) {
+			// std::bad_alloc, or whatever the handler threw.
+			return 0;
+		}
+	}
+
+	/**
+	 * Pass the last line to the handler if the body did not end with a
+	 * line ending.
+	 *
+	 * @returns false if the handler returned false.
+	 */
+	auto finish() -> bool
+	{
+		if (_partial.empty()) {
+			return true;
+		}
+		auto ok = emit(_partial.data(), _partial.size());
+		_partial.clear();
+		return ok;
+	}
+
+	/**
+	 * Drop a partial line, for reusing the splitter.
+	 */
+	void reset() noexcept
+	{
+		_partial.clear();
+		_overflow = false;
+	}
+
+	/**
+	 * @returns number of bytes of a line not yet complete.
+	 */
+	auto pending() const noexcept -> size_t
+	{
+		return _partial.size();
+	}
+
+	/**
+	 * @returns true iff a line was longer than max_line.
+	 */
+	auto overflowed() const noexcept -> bool
+	{
+		return _overflow;
+	}
+
+	auto handler() noexcept -> Handler&
+	{
+		return _handler;
+	}
+
+private:
+	auto split(const_buffer b) -> bool
+	{
+		auto p = b.data();
+		auto start = size_t(0);
+		auto ok = detail::for_each_byte(p, b.size(), '\n', [&](size_t end) {
+			auto good = true;
+			if (!_partial.empty()) {
+				// the line started in an earlier write event.
+				if (!keep(p, end)) {
+					return false;
+				}
+				good = emit(_partial.data(), _partial.size());
+				_partial.clear();
+			} else {
+				good = emit(p + start, end - start);
+			}
+			start = end + 1;
+			return good;
+		});
+		return ok && keep(p + start, b.size() - start);
+	}
+
+	/**
+	 * Add part of a line to the partial line.
+	 */
+	auto keep(const char* p, size_t n) -> bool
+	{
+		if (_partial.size() + n > _max_line) {
+			_overflow = true;
+			return false;
+		}
+		_partial.insert(_partial.end(), p, p + n);
+		return true;
+	}
+
+	auto emit(const char* p, size_t n) -> bool
+	{
+		if (n > 0 && p[n - 1] == '\r') {
+			--n;
+		}
+		return n == 0 || _handler(const_buffer{ p, n });
+	}
+
+	Handler           _handler;
+	size_t            _max_line;
+	std::vector<char> _partial;
+	bool              _overflow = false;
+};
+
+/**
+ * @returns line_splitter calling handler, deducing its type.
+ */
+template<typename Handler>
+auto make_line_splitter(Handler handler, size_t max_line = 16 * 1024 * 1024)
+	-> line_splitter<Handler>
+{
+	return line_splitter<Handler>(std::move(handler), max_line);
+}
+
+} // namespace curl
+#endif // CURLPLUSPLUS_LINE_SPLITTER_HPP
@@ -34,6 +34,7 @@ struct multi_ref
 	struct push;
 	struct socket;
 	struct timer;
+	struct done;
 
 	using detail::handle_base<CURLM*>::handle_base;
 
@@ -70,7 +71,7 @@ struct multi_ref
 	 */
 	auto perform() -> int
 	{
-		return invoke_r<int>(::curl_multi_perform, _handle);
+		return curl::invoke_r<int>(::curl_multi_perform, _handle);
 	}
 
 	/**
@@ -81,7 +82,7 @@ struct multi_ref
 	 */
 	void add_handle(easy_ref ref)
 	{
-		invoke(::curl_multi_add_handle, _handle, ref.raw());
+		curl::invoke(::curl_multi_add_handle, _handle, ref.raw());
 	}
 
 	/**
@@ -92,7 +93,7 @@ struct multi_ref
 	 */
 	void remove_handle(easy_ref ref)
 	{
-		invoke(::curl_multi_remove_handle, _handle, ref.raw());
+		curl::invoke(::curl_multi_remove_handle, _handle, ref.raw());
 	}
 
 	/**
@@ -107,6 +108,17 @@ struct multi_ref
 		return info_read_proxy{_handle};
 	}
 
+	/**
+	 * Drain all messages, removing each finished handle and invoking the
+	 * completion attached to it. Every handle on the multi handle must have
+	 * a completion attached, see completion::attach().
+	 *
+	 * @returns number of completions invoked.
+	 * @throws curl::mcode
+	 * @pre *this
+	 */
+	auto dispatch() -> size_t;
+
 	/**
 	 * see curl_multi_assign
 	 *
@@ -115,7 +127,7 @@ struct multi_ref
 	 */
 	void assign(socket_t sockfd, void* data)
 	{
-		invoke(::curl_multi_assign, _handle, sockfd, data);
+		curl::invoke(::curl_multi_assign, _handle, sockfd, data);
 	}
 
 	/**
@@ -126,8 +138,8 @@ struct multi_ref
 	 */
 	auto socket_action(socket_t sockfd, int ev_bitmask) -> int
 	{
-		return invoke_r<int>(::curl_multi_socket_action, _handle,
-		                     sockfd, ev_bitmask);
+		return curl::invoke_r<int>(::curl_multi_socket_action, _handle,
+		                           sockfd, ev_bitmask);
 	}
 
 	/**
@@ -139,8 +151,35 @@ struct multi_ref
 	 */
 	auto wait(std::chrono::milliseconds ms) -> int
 	{
-		return invoke_r<int>(::curl_multi_wait, _handle, nullptr, 0,
-		                     ms.count());
+		return curl::invoke_r<int>(::curl_multi_wait, _handle, nullptr, 0,
+		                           ms.count());
+	}
+
+	/**
+	 * see curl_multi_poll.
+	 * simple use case for no extra fds.
+	 * Unlike wait, returns early when wakeup() is called.
+	 *
+	 * @throws curl::code
+	 * @pre *this
+	 */
+	auto poll(std::chrono::milliseconds ms) -> int
+	{
+		return curl::invoke_r<int>(::curl_multi_poll, _handle, nullptr, 0,
+		                           ms.count());
+	}
+
+	/**
+	 * see curl_multi_wakeup.
+	 * Makes a blocked or the next call to poll() return early.
+	 * Safe to call from any thread.
+	 *
+	 * @throws curl::code
+	 * @pre *this
+	 */
+	void wakeup()
+	{
+		curl::invoke(::curl_multi_wakeup, _handle);
 	}
 
 	/**
@@ -152,7 +191,7 @@ struct multi_ref
 	auto timeout() -> std::chrono::milliseconds
 	{
 		return std::chrono::milliseconds(
-			invoke_r<long>(::curl_multi_timeout, _handle));
+			curl::invoke_r<long>(::curl_multi_timeout, _handle));
 	}
 
 	/**
@@ -164,7 +203,7 @@ struct multi_ref
 	template<typename T>
 	void setopt(CURLMoption o, T x)
 	{
-		invoke(::curl_multi_setopt, _handle, o, x);
+		curl::invoke(::curl_multi_setopt, _handle, o, x);
 	}
 
 	/**
@@ -185,6 +224,16 @@ struct multi_ref
 #undef SETOPT_FUNC
 };
 
+/**
+ * Emitted by dispatch() for each finished transfer, after its handle has
+ * been removed from the multi handle.
+ */
+struct multi_ref::done {
+	multi_ref multi;
+	easy_ref  easy;
+	code      result;
+};
+
 /**
  * Owning RAII wrapper for a curl multi handle
  */
@@ -259,4 +308,5 @@ protected:
 } // namespace curl
 
 #include "multi_events.hpp"
+#include "completion.hpp"
 #endif // CURLPLUSPLUS_MULTI_HPP
@@ -0,0 +1,437 @@
+#ifndef CURLPLUSPLUS_MULTI_POOL_HPP
+#define CURLPLUSPLUS_MULTI_POOL_HPP
+#include "completion.hpp"
+#include "easy.hpp"
+#include "epoll_loop.hpp"
+#include "host_router.hpp"
+#include "multi.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace curl {
+
+/**
+ * Runs transfers on a fixed number of worker threads, each owning a multi
+ * handle and an event loop.
+ *
+ * Submitted easy handles wait in a per worker queue until the worker has
+ * room for them. A worker with spare room and an empty queue steals waiting
+ * handles from the back of the fullest queue, so long transfers on one
+ * shard do not hold back requests that another shard could run.
+ *
+ * Requests submitted with a host_key are routed to the shard that holds
+ * warm connections for that host and are never stolen, since connection
+ * caches are per multi handle.
+ *
+ * Completion callbacks are invoked on the worker thread that ran the
+ * transfer, after the handle has been removed from its multi handle.
+ * Exceptions thrown by callbacks are caught and ignored, so they cannot
+ * stop a worker.
+ *
+ * A worker whose event loop fails completes everything it holds with
+ * CURLE_ABORTED_BY_CALLBACK and stops. Requests are no longer routed to
+ * it, and requests submitted to it go to another shard instead.
+ *
+ * @param Loop event loop type, such as epoll_loop or uring_loop.
+ * @warning easy handles must stay valid until their callback is invoked,
+ *          and their CURLOPT_PRIVATE is used by the pool while they run.
+ */
+template<typename Loop = epoll_loop>
+struct multi_pool {
+	using callback = std::function<void(easy_ref, code)>;
+
+	/**
+	 * Number of queued and running handles of a shard.
+	 */
+	struct shard_stats {
+		size_t queued;
+		size_t running;
+	};
+
+	/**
+	 * Start worker threads.
+	 *
+	 * @param threads number of shards.
+	 * @param max_running number of handles each shard runs at once.
+	 * @param max_overflow number of neighbour shards a host may overflow
+	 *        to when its own shard is saturated.
+	 * @throws std::system_error
+	 */
+	explicit multi_pool(size_t threads, size_t max_running = 1024,
+	                    size_t max_overflow = 1)
+	: _router(threads, max_overflow)
+	, _max_running(max_running)
+	{
+		_shards.reserve(threads);
+		for (size_t i = 0; i < threads; ++i) {
+			_shards.emplace_back(new shard);
+		}
+		for (auto& s : _shards) {
+			s->thread = std::thread(&multi_pool::work, this, std::ref(*s));
+		}
+	}
+
+	multi_pool(multi_pool const&) = delete;
+	auto operator=(multi_pool const&) -> multi_pool& = delete;
+
+	/**
+	 * Stop workers. Unfinished requests complete with
+	 * CURLE_ABORTED_BY_CALLBACK.
+	 */
+	~multi_pool() noexcept
+	{
+		_stop = true;
+		for (auto& s : _shards) {
+			s->loop.wakeup();
+		}
+		for (auto& s : _shards) {
+			s->thread.join();
+		}
+	}
+
+	/**
+	 * Queue a request on the least loaded shard.
+	 * Completes it with CURLE_FAILED_INIT if every shard has stopped.
+	 */
+	void submit(easy_ref e, callback cb)
+	{
+		auto best = least_loaded();
+		if (best == _shards.size()) {
+			notify(cb, e, CURLE_FAILED_INIT);
+			return;
+		}
+		submit(best, e, std::move(cb));
+	}
+
+	/**
+	 * Queue a request on the given shard, or the least loaded one if it
+	 * has stopped.
+	 * It may still be stolen by another shard before it starts.
+	 */
+	void submit(size_t index, easy_ref e, callback cb)
+	{
+		auto& s = *_shards[index];
+		auto queued = size_t(0);
+		{
+			std::lock_guard<std::mutex> lock(s.mutex);
+			if (!s.dead) {
+				s.queue.push_back({ e, std::move(cb) });
+				queued = s.queue.size();
+				s.queued.store(queued + s.pinned.size(), std::memory_order_relaxed);
+				s.stealable.store(queued, std::memory_order_relaxed);
+			}
+		}
+		if (queued == 0) {
+			submit(e, std::move(cb));
+			return;
+		}
+		s.loop.wakeup();
+		if (queued + s.running.load(std::memory_order_relaxed) > _max_running) {
+			wake_hungry(s);
+		}
+	}
+
+	/**
+	 * Queue a request on the shard chosen for its host.
+	 * It is never stolen by another shard.
+	 * Completes it with CURLE_FAILED_INIT if every shard has stopped.
+	 */
+	void submit(host_key host, easy_ref e, callback cb)
+	{
+		auto index = route(host);
+		if (index == _shards.size()) {
+			notify(cb, e, CURLE_FAILED_INIT);
+			return;
+		}
+		auto& s = *_shards[index];
+		auto pinned = false;
+		{
+			std::lock_guard<std::mutex> lock(s.mutex);
+			if (!s.dead) {
+				s.pinned.push_back({ e, std::move(cb) });
+				s.queued.store(s.queue.size() + s.pinned.size(),
+				               std::memory_order_relaxed);
+				pinned = true;
+			}
+		}
+		if (!pinned) {
+			// stopped since it was routed to.
+			submit(host, e, std::move(cb));
+			return;
+		}
+		s.loop.wakeup();
+	}
+
+	/**
+	 * @returns shard a request for host would be submitted to, skipping
+	 *          stopped shards, or size() if every shard has stopped.
+	 */
+	auto route(host_key host) const noexcept -> size_t
+	{
+		auto index = _router.route(host, [this](size_t i) {
+			auto& s = *_shards[i];
+			return s.dead.load()
+			    || s.queued.load(std::memory_order_relaxed)
+			     + s.running.load(std::memory_order_relaxed)
+			    >= _max_running;
+		});
+		return _shards[index]->dead.load() ? least_loaded() : index;
+	}
+
+	/**
+	 * @returns number of shards.
+	 */
+	auto size() const noexcept -> size_t
+	{
+		return _shards.size();
+	}
+
+	/**
+	 * @returns queue depth and running handle count of a shard.
+	 */
+	auto stats(size_t index) const noexcept -> shard_stats
+	{
+		auto& s = *_shards[index];
+		return { s.queued.load(std::memory_order_relaxed)
+		       , s.running.load(std::memory_order_relaxed) };
+	}
+
+	/**
+	 * @returns false if the worker of a shard has stopped after its event
+	 *          loop failed.
+	 */
+	auto alive(size_t index) const noexcept -> bool
+	{
+		return !_shards[index]->dead.load();
+	}
+
+private:
+	struct request {
+		easy_ref handle;
+		callback done;
+	};
+
+	struct shard;
+
+	/**
+	 * Request added to a multi handle, attached as its completion.
+	 */
+	struct running_request {
+		running_request(shard& s, request r)
+		: owner(&s)
+		, handle(r.handle)
+		, done(std::move(r.done))
+		{}
+
+		void on(multi_ref::done d)
+		{
+			auto cb = std::move(done);
+			owner->active.erase(self);
+			notify(cb, d.easy, d.result);
+		}
+
+		shard*                                       owner;
+		easy_ref                                     handle;
+		callback                                     done;
+		typename std::list<running_request>::iterator self;
+		curl::completion                             completion{this};
+	};
+
+	struct shard {
+		multi                        handle;
+		Loop                         loop{handle};
+		std::mutex                   mutex;
+		std::deque<request>          queue;
+		std::deque<request>          pinned;
+		std::atomic<size_t>          queued{0};
+		std::atomic<size_t>          stealable{0};
+		std::atomic<size_t>          running{0};
+		std::atomic<bool>            hungry{false};
+		std::atomic<bool>            dead{false};
+		std::list<running_request>   active;
+		std::thread                  thread;
+	};
+
+	void work(shard& s) noexcept
+	{
+		try {
+			while (!_stop) {
+				admit(s);
+				s.loop.run_once();
+				complete(s);
+			}
+		} catch (...) {
+			// loop failure, stop taking requests and fail everything
+			// this shard holds.
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.dead = true;
+			s.hungry.store(false, std::memory_order_relaxed);
+		}
+		abort(s);
+	}
+
+	/**
+	 * @returns index of the running shard with the fewest queued and
+	 *          running handles, or size() if every shard has stopped.
+	 */
+	auto least_loaded() const noexcept -> size_t
+	{
+		auto best = _shards.size();
+		auto load = ~size_t(0);
+		for (size_t i = 0; i < _shards.size(); ++i) {
+			auto& s = *_shards[i];
+			auto l = s.queued.load(std::memory_order_relaxed)
+			       + s.running.load(std::memory_order_relaxed);
+			if (!s.dead.load() && l < load) {
+				best = i;
+				load = l;
+			}
+		}
+		return best;
+	}
+
+	/**
+	 * Invoke a completion callback, ignoring what it throws so it cannot
+	 * stop the worker.
+	 */
+	static void notify(callback& cb, easy_ref e, code c) noexcept
+	{
+		try {
+			cb(e, c);
+		} catch (...) {
+		}
+	}
+
+	/**
+	 * Move requests from the queue into the multi handle, stealing from
+	 * other shards if our own queue runs dry.
+	 */
+	void admit(shard& s)
+	{
+		auto room = _max_running - std::min(_max_running, s.active.size());
+		std::deque<request> batch;
+		{
+			std::lock_guard<std::mutex> lock(s.mutex);
+			for (auto q : { &s.pinned, &s.queue }) {
+				while (room > 0 && !q->empty()) {
+					batch.push_back(std::move(q->front()));
+					q->pop_front();
+					--room;
+				}
+			}
+			s.queued.store(s.queue.size() + s.pinned.size(),
+			               std::memory_order_relaxed);
+			s.stealable.store(s.queue.size(), std::memory_order_relaxed);
+		}
+		if (room > 0) {
+			room -= steal(s, room, batch);
+		} else if (s.stealable.load(std::memory_order_relaxed) > 0) {
+			wake_hungry(s);
+		}
+		s.hungry.store(room > 0, std::memory_order_relaxed);
+		for (auto& r : batch) {
+			start(s, std::move(r));
+		}
+		s.running.store(s.active.size(), std::memory_order_relaxed);
+	}
+
+	/**
+	 * Wake a shard with spare room so it can steal from s.
+	 */
+	void wake_hungry(shard& s) noexcept
+	{
+		for (auto& t : _shards) {
+			if (t.get() != &s && t->hungry.load(std::memory_order_relaxed)) {
+				t->loop.wakeup();
+				return;
+			}
+		}
+	}
+
+	/**
+	 * Take up to half of the fullest other queue, from the back.
+	 */
+	auto steal(shard& s, size_t room, std::deque<request>& batch) -> size_t
+	{
+		shard* victim = nullptr;
+		auto most = size_t(0);
+		for (auto& t : _shards) {
+			auto q = t->stealable.load(std::memory_order_relaxed);
+			if (t.get() != &s && q > most) {
+				victim = t.get();
+				most   = q;
+			}
+		}
+		if (victim == nullptr) {
+			return 0;
+		}
+		std::lock_guard<std::mutex> lock(victim->mutex);
+		auto n = std::min(room, (victim->queue.size() + 1) / 2);
+		for (size_t i = 0; i < n; ++i) {
+			batch.push_back(std::move(victim->queue.back()));
+			victim->queue.pop_back();
+		}
+		victim->queued.store(victim->queue.size() + victim->pinned.size(),
+		                     std::memory_order_relaxed);
+		victim->stealable.store(victim->queue.size(), std::memory_order_relaxed);
+		return n;
+	}
+
+	void start(shard& s, request r)
+	{
+		auto it = s.active.emplace(s.active.end(), s, std::move(r));
+		it->self = it;
+		try {
+			it->completion.attach(it->handle);
+			s.handle.add_handle(it->handle);
+		} catch (std::exception const&) {
+			auto cb = std::move(it->done);
+			auto e  = it->handle;
+			s.active.erase(it);
+			notify(cb, e, CURLE_FAILED_INIT);
+		}
+	}
+
+	void complete(shard& s)
+	{
+		s.handle.dispatch();
+		s.running.store(s.active.size(), std::memory_order_relaxed);
+	}
+
+	void abort(shard& s) noexcept
+	{
+		for (auto& a : s.active) {
+			::curl_multi_remove_handle(s.handle.raw(), a.handle.raw());
+			notify(a.done, a.handle, CURLE_ABORTED_BY_CALLBACK);
+		}
+		s.active.clear();
+		std::lock_guard<std::mutex> lock(s.mutex);
+		for (auto q : { &s.pinned, &s.queue }) {
+			for (auto& r : *q) {
+				notify(r.done, r.handle, CURLE_ABORTED_BY_CALLBACK);
+			}
+			q->clear();
+		}
+		s.queued.store(0, std::memory_order_relaxed);
+		s.stealable.store(0, std::memory_order_relaxed);
+		s.running.store(0, std::memory_order_relaxed);
+	}
+
+	std::vector<std::unique_ptr<shard>> _shards;
+	host_router                         _router;
+	size_t                              _max_running;
+	std::atomic<bool>                   _stop{false};
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_MULTI_POOL_HPP
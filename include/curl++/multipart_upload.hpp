@@ -0,0 +1,355 @@
+#ifndef CURLPLUSPLUS_MULTIPART_UPLOAD_HPP
+#define CURLPLUSPLUS_MULTIPART_UPLOAD_HPP
+#include "completion.hpp"
+#include "easy.hpp"
+#include "epoll_loop.hpp"
+#include "header_line.hpp"
+#include "multi.hpp"
+#include "prototype.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <curl/curl.h>
+#include <fcntl.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace curl {
+
+/**
+ * Uploads a local file as several parts at once, such as for the multipart
+ * upload of an object store.
+ *
+ * Each part is sent with PUT to the url given for its number, read from the
+ * file with pread straight into the upload buffer of libcurl, so nothing
+ * but those buffers is held in memory: at most options::parallel of them,
+ * each options::buffer bytes. A part that fails is retried on its own.
+ * Parts are numbered from 1, and the ETag of each is kept for completing
+ * the upload.
+ *
+ * example usage:
+ * @code
+ *   curl::prototype proto;
+ *   proto.handle().setopt(CURLOPT_HTTPHEADER, auth_headers);
+ *   curl::multipart_upload<> up(proto, "big.bin", [&](size_t n) {
+ *     return base + "?partNumber=" + std::to_string(n) + "&uploadId=" + id;
+ *   });
+ *   up.run();
+ *   for (auto& p : up.parts()) {
+ *     add_to_manifest(p.number, p.etag);
+ *   }
+ * @endcode
+ *
+ * @param Loop event loop type, such as epoll_loop or uring_loop.
+ */
+template<typename Loop = epoll_loop>
+struct multipart_upload {
+	struct options {
+		size_t part_size = 8 * 1024 * 1024; // bytes per part, but the last.
+		size_t parallel  = 4;               // parts uploaded at once.
+		size_t retries   = 3;               // extra attempts per part.
+		size_t buffer    = 64 * 1024;       // upload buffer of each transfer.
+	};
+
+	/**
+	 * Outcome of one part.
+	 */
+	struct part_stats {
+		size_t                    number;
+		size_t                    offset;
+		size_t                    length;
+		size_t                    attempts;
+		std::chrono::microseconds elapsed;    // summed over attempts.
+		double                    throughput; // bytes per second.
+		long                      status;
+		std::string               etag;
+		code                      result;
+	};
+
+	/**
+	 * @returns url to upload part number to.
+	 */
+	using url_function = std::function<std::string(size_t number)>;
+
+	/**
+	 * @param proto handle with the options shared by all parts, cloned for
+	 *        every transfer.
+	 * @param path file to upload.
+	 * @param url url of each part.
+	 */
+	multipart_upload(prototype const& proto, const char* path, url_function url)
+	: multipart_upload(proto, path, std::move(url), options())
+	{}
+
+	/**
+	 * @throws std::system_error
+	 */
+	multipart_upload(prototype const& proto, const char* path, url_function url, options o)
+	: _proto(&proto)
+	, _url(std::move(url))
+	, _options(o)
+	, _fd(::open(path, O_RDONLY | O_CLOEXEC))
+	{
+		if (_fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "open");
+		}
+		struct stat st;
+		if (::fstat(_fd, &st) != 0) {
+			auto e = errno;
+			::close(_fd);
+			throw std::system_error(e, std::generic_category(), "fstat");
+		}
+		_size = static_cast<size_t>(st.st_size);
+		if (_options.part_size == 0) {
+			_options.part_size = options().part_size;
+		}
+		_options.parallel = std::max<size_t>(1, _options.parallel);
+	}
+
+	multipart_upload(multipart_upload const&) = delete;
+	auto operator=(multipart_upload const&) -> multipart_upload& = delete;
+
+	~multipart_upload() noexcept
+	{
+		::close(_fd);
+	}
+
+	/**
+	 * Upload every part.
+	 *
+	 * @throws curl::code of the first part that failed for good, with
+	 *         CURLE_HTTP_RETURNED_ERROR for an error status.
+	 * @throws curl::mcode
+	 * @throws std::runtime_error
+	 */
+	void run()
+	{
+		split();
+		multi m;
+		Loop loop(m);
+		_next      = 0;
+		_remaining = _parts.size();
+		_slots.clear();
+		auto count = std::min(_options.parallel, _parts.size());
+		for (size_t i = 0; i < count; ++i) {
+			_slots.push_back(_proto->make_unique<slot>());
+			_slots.back()->owner = this;
+			start(m, *_slots.back(), _parts[_next++]);
+		}
+		while (_remaining > 0) {
+			loop.run_once();
+			m.dispatch();
+		}
+		_slots.clear();
+		for (auto& p : _parts) {
+			if (p.result) {
+				throw p.result;
+			}
+		}
+	}
+
+	/**
+	 * @returns size of the file.
+	 */
+	auto size() const noexcept -> size_t
+	{
+		return _size;
+	}
+
+	/**
+	 * @returns outcome of every part, in order, after run().
+	 */
+	auto parts() const -> std::vector<part_stats>
+	{
+		std::vector<part_stats> v;
+		v.reserve(_parts.size());
+		for (auto& p : _parts) {
+			auto secs = std::chrono::duration<double>(p.elapsed).count();
+			v.push_back({ p.number, p.offset, p.length, p.attempts, p.elapsed,
+			              secs > 0 && !p.result ? p.length / secs : 0.0, p.status, p.etag,
+			              p.result });
+		}
+		return v;
+	}
+
+private:
+	struct part {
+		size_t                    number   = 0;
+		size_t                    offset   = 0;
+		size_t                    length   = 0;
+		size_t                    attempts = 0;
+		std::chrono::microseconds elapsed{0};
+		long                      status   = 0;
+		std::string               etag;
+		code                      result   = CURLE_OK;
+	};
+
+	/**
+	 * A transfer, uploading one part after another.
+	 */
+	struct slot : easy_base<slot> {
+		using easy_base<slot>::easy_base;
+
+		auto on(easy_ref::read r) noexcept -> size_t
+		{
+			auto n = std::min(r.size(), current->length - position);
+			if (n == 0) {
+				return 0;
+			}
+			auto off = static_cast<off_t>(current->offset + position);
+			auto got = ::pread(owner->_fd, r.data(), n, off);
+			while (got < 0 && errno == EINTR) {
+				got = ::pread(owner->_fd, r.data(), n, off);
+			}
+			if (got <= 0) {
+				// the file shrank or could not be read.
+				error = got < 0 ? errno : EIO;
+				return CURL_READFUNC_ABORT;
+			}
+			position += static_cast<size_t>(got);
+			return static_cast<size_t>(got);
+		}
+
+		auto on(easy_ref::seek s) noexcept -> int
+		{
+			auto base = s.origin == SEEK_CUR ? static_cast<curl_off_t>(position)
+			          : s.origin == SEEK_END ? static_cast<curl_off_t>(current->length)
+			          : 0;
+			auto to = base + s.offset;
+			if (to < 0 || static_cast<size_t>(to) > current->length) {
+				return CURL_SEEKFUNC_FAIL;
+			}
+			position = static_cast<size_t>(to);
+			return CURL_SEEKFUNC_OK;
+		}
+
+		auto on(easy_ref::header h) noexcept -> size_t
+		{
+			if (detail::is_status_line(h)) {
+				etag.clear();
+			} else if (detail::header_is(h, "etag")) {
+				auto v = detail::header_value(h);
+				try {
+					etag.assign(v.data(), v.size());
+				} catch (std::bad_alloc const&) {
+					return 0;
+				}
+			}
+			return h.size();
+		}
+
+		auto on(easy_ref::write w) noexcept -> size_t
+		{
+			// the response body is of no interest.
+			return w.size();
+		}
+
+		multipart_upload* owner    = nullptr;
+		part*             current  = nullptr;
+		size_t            position = 0;
+		int               error    = 0;
+		std::string       etag;
+		curl::completion  done{&finished, this};
+	};
+
+	void split()
+	{
+		auto step  = _options.part_size;
+		auto count = std::max<size_t>(1, (_size + step - 1) / step);
+		_parts.assign(count, part());
+		for (size_t i = 0; i < count; ++i) {
+			_parts[i].number = i + 1;
+			_parts[i].offset = i * step;
+			_parts[i].length = std::min(step, _size - i * step);
+		}
+	}
+
+	/**
+	 * Upload p from its start with s.
+	 */
+	void start(multi_ref m, slot& s, part& p)
+	{
+		s.current  = &p;
+		s.position = 0;
+		s.error    = 0;
+		s.etag.clear();
+		s.url(_url(p.number));
+		s.setopt(CURLOPT_UPLOAD, 1L);
+		s.setopt(CURLOPT_INFILESIZE_LARGE, static_cast<curl_off_t>(p.length));
+		s.setopt(CURLOPT_UPLOAD_BUFFERSIZE, static_cast<long>(_options.buffer));
+		++p.attempts;
+		s.done.attach(s);
+		m.add_handle(s);
+	}
+
+	static void finished(void* x, multi_ref::done d)
+	{
+		auto& s = *static_cast<slot*>(x);
+		s.owner->finished(s, d);
+	}
+
+	void finished(slot& s, multi_ref::done d)
+	{
+		auto& p = *s.current;
+		auto result = d.result;
+		p.elapsed += s.total_time();
+		p.status = s.response_code();
+		auto retry = true;
+		if (s.error != 0) {
+			// reading the file failed, which no retry will fix.
+			result = CURLE_READ_ERROR;
+			retry  = false;
+		} else if (!result && (p.status < 200 || p.status >= 300)) {
+			result = CURLE_HTTP_RETURNED_ERROR;
+			retry  = detail::retryable_status(p.status);
+		}
+		if (result && retry && p.attempts <= _options.retries) {
+			if (try_start(d.multi, s, p)) {
+				return;
+			}
+		}
+		p.result = result;
+		p.etag   = std::move(s.etag);
+		--_remaining;
+		while (_next < _parts.size()) {
+			auto& n = _parts[_next++];
+			if (try_start(d.multi, s, n)) {
+				return;
+			}
+			n.result = CURLE_FAILED_INIT;
+			--_remaining;
+		}
+	}
+
+	auto try_start(multi_ref m, slot& s, part& p) noexcept -> bool
+	{
+		try {
+			start(m, s, p);
+			return true;
+		} catch (std::exception const&) {
+			return false;
+		}
+	}
+
+	prototype const*                   _proto;
+	url_function                       _url;
+	options                            _options;
+	int                                _fd;
+	size_t                             _size = 0;
+	std::vector<part>                  _parts;
+	std::vector<std::unique_ptr<slot>> _slots;
+	size_t                             _next      = 0;
+	size_t                             _remaining = 0;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_MULTIPART_UPLOAD_HPP
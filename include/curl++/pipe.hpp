@@ -0,0 +1,311 @@
+#ifndef CURLPLUSPLUS_PIPE_HPP
+#define CURLPLUSPLUS_PIPE_HPP
+#include "byte_ring.hpp"
+#include "completion.hpp"
+#include "easy.hpp"
+#include "header_line.hpp"
+#include "multi.hpp"
+#include "submission_queue.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <curl/curl.h>
+#include <new>
+
+namespace curl {
+
+/**
+ * Uploads the response of one transfer with another while it is being
+ * received, through a small ring, such as for copying an object from one
+ * store to another without temporary storage.
+ *
+ * Both transfers run on the same multi handle. The source is paused when
+ * the ring is too full for a write event, and the destination when it is
+ * empty. Either is resumed through the submission queue once the other
+ * has made progress, as a handle must not be unpaused from within the
+ * callbacks of another.
+ *
+ * The destination is added once the source starts receiving its body, so
+ * its size is known when the source announces it. Otherwise it is sent
+ * with chunked transfer encoding. An error status of the source fails it
+ * with CURLE_HTTP_RETURNED_ERROR before anything is uploaded, and a
+ * failed destination cancels the source.
+ *
+ * The pipe handles completion of both transfers, so it takes the place of
+ * easy_ref::userdata() of both.
+ *
+ * example usage:
+ * @code
+ *   curl::submission_queue<curl::epoll_loop> queue(m, loop);
+ *   curl::pipe<curl::epoll_loop> p(queue);
+ *   src.url(from);
+ *   dst.url(to);
+ *   p.start(src, dst);
+ *   while (!p.done()) {
+ *     loop.run_once();
+ *     queue.drain();
+ *     m.dispatch();
+ *   }
+ *   if (p.result()) { ... }
+ * @endcode
+ *
+ * @param Waker waker of the submission queue running the transfers.
+ */
+template<typename Waker>
+struct pipe {
+	/**
+	 * @param queue submission queue of the multi handle running the
+	 *        transfers.
+	 * @param capacity size of the ring, rounded up to a power of two.
+	 * @throws std::bad_alloc
+	 */
+	explicit pipe(submission_queue<Waker>& queue, size_t capacity = 256 * 1024)
+	: _queue(&queue)
+	, _ring(std::max<size_t>(capacity, CURL_MAX_WRITE_SIZE))
+	{}
+
+	pipe(pipe const&) = delete;
+	auto operator=(pipe const&) -> pipe& = delete;
+
+	/**
+	 * Submit src, and dst once the body of src starts. dst is set up for
+	 * an upload, which libcurl sends as PUT; set CURLOPT_CUSTOMREQUEST on
+	 * dst for another method such as POST.
+	 * Both must outlive the transfers.
+	 *
+	 * @throws curl::code
+	 * @throws std::bad_alloc
+	 */
+	void start(easy_ref src, easy_ref dst)
+	{
+		src.set_handler<easy_ref::header>(this);
+		src.set_handler<easy_ref::write>(this);
+		dst.set_handler<easy_ref::read>(this);
+		dst.setopt(CURLOPT_UPLOAD, 1L);
+		_src_done.attach(src);
+		_dst_done.attach(dst);
+		_src = src;
+		_dst = dst;
+		_queue->add(src);
+	}
+
+	/**
+	 * Look for the length of the source, for use as a handler of its
+	 * header events.
+	 */
+	auto on(easy_ref::header h) noexcept -> size_t
+	{
+		if (detail::is_status_line(h)) {
+			_length = detail::unknown_length;
+		} else {
+			auto n = detail::content_length(h);
+			if (n != detail::unknown_length) {
+				_length = n;
+			}
+		}
+		return h.size();
+	}
+
+	/**
+	 * Copy the body of the source into the ring, for use as a handler of
+	 * its write events.
+	 *
+	 * @returns CURL_WRITEFUNC_PAUSE if the ring is too full.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		if (!_dst_started && !start_dst()) {
+			return 0;
+		}
+		if (w.size() > _ring.capacity()) {
+			return 0;
+		}
+		if (_ring.space() < w.size()) {
+			_wanted     = w.size();
+			_src_paused = true;
+			return CURL_WRITEFUNC_PAUSE;
+		}
+		_ring.push(w.data(), w.size());
+		if (_dst_paused) {
+			_dst_paused = false;
+			resume(_dst);
+		}
+		return w.size();
+	}
+
+	/**
+	 * Copy the ring into the body of the destination, for use as a handler
+	 * of its read events.
+	 *
+	 * @returns CURL_READFUNC_PAUSE if the ring is empty, 0 at the end.
+	 */
+	auto on(easy_ref::read r) noexcept -> size_t
+	{
+		auto n = _ring.pop(r.data(), r.size());
+		if (n == 0) {
+			if (!_src_finished) {
+				_dst_paused = true;
+				return CURL_READFUNC_PAUSE;
+			}
+			// do not let a truncated source pass for a whole one.
+			return _src_result ? CURL_READFUNC_ABORT : 0;
+		}
+		if (_src_paused && _ring.space() >= _wanted) {
+			_src_paused = false;
+			resume(_src);
+		}
+		return n;
+	}
+
+	/**
+	 * @returns true iff both transfers have finished.
+	 */
+	auto done() const noexcept -> bool
+	{
+		return _src_finished && (_dst_finished || !_dst_started);
+	}
+
+	/**
+	 * @returns result of the source if it failed, otherwise that of the
+	 *          destination.
+	 * @pre done()
+	 */
+	auto result() const noexcept -> code
+	{
+		return _src_result ? _src_result : _dst_result;
+	}
+
+	/**
+	 * @returns result of the source.
+	 */
+	auto source_result() const noexcept -> code
+	{
+		return _src_result;
+	}
+
+	/**
+	 * @returns result of the destination.
+	 */
+	auto destination_result() const noexcept -> code
+	{
+		return _dst_result;
+	}
+
+private:
+	/**
+	 * Submit the destination with the length of the source, unless the
+	 * source got an error status.
+	 *
+	 * @returns false if the destination was not started, with the reason
+	 *          in _http_error or _dst_result.
+	 */
+	auto start_dst() noexcept -> bool
+	{
+		try {
+			if (http_error()) {
+				return false;
+			}
+			auto size = _length == detail::unknown_length
+			          ? curl_off_t(-1) : static_cast<curl_off_t>(_length);
+			_dst.setopt(CURLOPT_INFILESIZE_LARGE, size);
+			_queue->add(_dst);
+		} catch (curl::code const& c) {
+			_dst_result = c;
+			return false;
+		} catch (std::bad_alloc const&) {
+			_dst_result = CURLE_OUT_OF_MEMORY;
+			return false;
+		}
+		_dst_started = true;
+		return true;
+	}
+
+	/**
+	 * @returns true iff the source got an error status.
+	 * @throws curl::code
+	 */
+	auto http_error() -> bool
+	{
+		if (!_http_error && _src.response_code() >= 400) {
+			_http_error = true;
+		}
+		return _http_error;
+	}
+
+	void resume(easy_ref e) noexcept
+	{
+		try {
+			_queue->resume(e);
+		} catch (std::bad_alloc const&) {
+			// nothing left to do but cancel both.
+			cancel(_src);
+			cancel(_dst);
+		}
+	}
+
+	void cancel(easy_ref e) noexcept
+	{
+		try {
+			_queue->cancel(e);
+		} catch (std::bad_alloc const&) {
+		}
+	}
+
+	static void src_finished(void* x, multi_ref::done d)
+	{
+		auto& p = *static_cast<pipe*>(x);
+		p._src_finished = true;
+		try {
+			// an error status with an empty body has had no write
+			// event to notice it.
+			p.http_error();
+		} catch (curl::code const&) {
+		}
+		p._src_result = p._http_error ? code(CURLE_HTTP_RETURNED_ERROR) : d.result;
+		if (!p._dst_started && !p._src_result) {
+			// an empty body never started the destination. If it
+			// cannot be started now, _dst_result says why.
+			p.start_dst();
+		}
+		if (p._dst_paused) {
+			p._dst_paused = false;
+			p.resume(p._dst);
+		}
+	}
+
+	static void dst_finished(void* x, multi_ref::done d)
+	{
+		auto& p = *static_cast<pipe*>(x);
+		p._dst_finished = true;
+		p._dst_result = d.result;
+		if (!d.result && p._dst.response_code() >= 400) {
+			p._dst_result = CURLE_HTTP_RETURNED_ERROR;
+		}
+		if (!p._src_finished) {
+			// nothing is left to take the rest of the source.
+			p.cancel(p._src);
+			p._src_finished = true;
+		}
+	}
+
+	submission_queue<Waker>* _queue;
+	detail::byte_ring        _ring;
+	easy_ref                 _src;
+	easy_ref                 _dst;
+	completion               _src_done{&src_finished, this};
+	completion               _dst_done{&dst_finished, this};
+	size_t                   _length       = detail::unknown_length;
+	size_t                   _wanted       = 0;
+	code                     _src_result   = CURLE_OK;
+	code                     _dst_result   = CURLE_OK;
+	bool                     _src_paused   = false;
+	bool                     _dst_paused   = false;
+	bool                     _dst_started  = false;
+	bool                     _src_finished = false;
+	bool                     _dst_finished = false;
+	bool                     _http_error   = false;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_PIPE_HPP
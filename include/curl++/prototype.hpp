@@ -0,0 +1,137 @@
+#ifndef CURLPLUSPLUS_PROTOTYPE_HPP
+#define CURLPLUSPLUS_PROTOTYPE_HPP
+#include "easy.hpp"
+
+#include <curl/curl.h>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace curl {
+
+/**
+ * Easy handle configured once with the options shared by many requests,
+ * from which new handles are cloned with curl_easy_duphandle.
+ *
+ * example usage:
+ * @code
+ *   curl::prototype proto;
+ *   proto.handle().follow_location(true);
+ *   proto.setopt(CURLOPT_TIMEOUT_MS, 5000L);
+ *   proto.setopt(CURLOPT_HTTPHEADER, headers);
+ *   ...
+ *   auto e = proto.make_unique<request>();
+ *   e->url(url);
+ * @endcode
+ *
+ * Types derived from easy_base get their handlers set up on the clone, so
+ * callbacks and their data pointers refer to the new object rather than
+ * whatever was set on the prototype.
+ *
+ * @warning Pointers set on the prototype, such as header lists, share
+ *          handles, error buffers and CURLOPT_PRIVATE, are copied as is.
+ *          They must outlive every clone, and must not be state a clone
+ *          expects to own.
+ */
+struct prototype {
+	/**
+	 * @throws std::runtime_error
+	 */
+	prototype() = default;
+
+	prototype(prototype&&) noexcept = default;
+	auto operator=(prototype&&) noexcept -> prototype& = default;
+
+	/**
+	 * @returns the handle being configured, for its named setters.
+	 */
+	auto handle() noexcept -> easy_ref
+	{
+		return _handle;
+	}
+
+	/**
+	 * see curl_easy_setopt.
+	 *
+	 * @throws curl::code
+	 */
+	template<typename T>
+	void setopt(CURLoption o, T x)
+	{
+		_handle.setopt(o, x);
+	}
+
+	/**
+	 * @returns new handle with the options of the prototype.
+	 * @throws std::runtime_error
+	 */
+	auto make() const -> easy
+	{
+		return easy(clone());
+	}
+
+	/**
+	 * @returns new T holding a clone of the prototype, with T's handlers
+	 *          set up on it.
+	 *
+	 * T is constructed from the cloned handle if it can be, for instance by
+	 * inheriting the constructors of easy_base. Otherwise it is default
+	 * constructed and its handle replaced.
+	 *
+	 * @throws std::runtime_error
+	 */
+	template<typename T, typename... Args>
+	auto make_unique(Args&&... args) const -> std::unique_ptr<T>
+	{
+		return construct<T>(std::is_constructible<T, easy_ref, Args...>(),
+		                    std::forward<Args>(args)...);
+	}
+
+	/**
+	 * Replace the handle of e with a clone of the prototype, then set up
+	 * e's handlers on it.
+	 *
+	 * @throws std::runtime_error
+	 */
+	template<typename T>
+	void clone_into(easy_base<T>& e) const
+	{
+		e.reset(clone());
+		e.set_handlers();
+	}
+
+private:
+	auto clone() const -> CURL*
+	{
+		auto h = ::curl_easy_duphandle(_handle.raw());
+		if (h == nullptr) {
+			throw std::runtime_error("failed to duplicate easy handle");
+		}
+		return h;
+	}
+
+	template<typename T, typename... Args>
+	auto construct(std::true_type, Args&&... args) const
+		-> std::unique_ptr<T>
+	{
+		auto e = easy(clone());
+		auto p = std::unique_ptr<T>(new T(e, std::forward<Args>(args)...));
+		e.release();
+		return p;
+	}
+
+	template<typename T, typename... Args>
+	auto construct(std::false_type, Args&&... args) const
+		-> std::unique_ptr<T>
+	{
+		auto p = std::unique_ptr<T>(new T(std::forward<Args>(args)...));
+		clone_into(*p);
+		return p;
+	}
+
+	easy _handle;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_PROTOTYPE_HPP
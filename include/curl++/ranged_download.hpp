@@ -0,0 +1,356 @@
+#ifndef CURLPLUSPLUS_RANGED_DOWNLOAD_HPP
+#define CURLPLUSPLUS_RANGED_DOWNLOAD_HPP
+#include "completion.hpp"
+#include "easy.hpp"
+#include "epoll_loop.hpp"
+#include "file_sink.hpp"
+#include "header_line.hpp"
+#include "multi.hpp"
+#include "prototype.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <fcntl.h>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace curl {
+
+/**
+ * Downloads one large object over several connections at once, each
+ * fetching a byte range of it into its place in the same file.
+ *
+ * The size of the object comes from a HEAD request. The file is
+ * preallocated, split into ranges, and each range is written at its offset
+ * with a pwrite_sink. A range that fails is retried from the last byte it
+ * wrote, without touching the others. If the size is unknown, the object
+ * is fetched as a single range, and an empty object is not fetched at all.
+ *
+ * Only the body of a response with the expected status is written, so an
+ * error page never ends up in the file. Transport errors, 5xx statuses,
+ * 408 and 429 are retried; other statuses fail the range for good.
+ *
+ * example usage:
+ * @code
+ *   curl::prototype proto;
+ *   proto.handle().url(url);
+ *   proto.handle().follow_location(true);
+ *   curl::ranged_download<> d(proto, "out.bin");
+ *   d.run();
+ *   for (auto& r : d.ranges()) {
+ *     printf("%zu bytes at %.1f MB/s\n", r.length, r.throughput / 1e6);
+ *   }
+ * @endcode
+ *
+ * @param Loop event loop type, such as epoll_loop or uring_loop.
+ */
+template<typename Loop = epoll_loop>
+struct ranged_download {
+	struct options {
+		size_t parts    = 8;               // ranges fetched at once.
+		size_t min_part = 1024 * 1024;     // smallest range worth its own request.
+		size_t retries  = 3;               // extra attempts per range.
+		pwrite_sink::options sink;         // how each range is written.
+	};
+
+	/**
+	 * Outcome of one range.
+	 */
+	struct range_stats {
+		size_t                    offset;
+		size_t                    length;
+		size_t                    written;
+		size_t                    attempts;
+		std::chrono::microseconds elapsed;    // summed over attempts.
+		double                    throughput; // bytes per second.
+		code                      result;
+	};
+
+	/**
+	 * @param proto handle with the url and shared options set, cloned for
+	 *        every request.
+	 * @param path file to write, created or truncated.
+	 */
+	ranged_download(prototype const& proto, const char* path)
+	: ranged_download(proto, path, options())
+	{}
+
+	/**
+	 * @throws std::system_error
+	 */
+	ranged_download(prototype const& proto, const char* path, options o)
+	: _proto(&proto)
+	, _options(o)
+	, _fd(::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644))
+	{
+		if (_fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "open");
+		}
+	}
+
+	ranged_download(ranged_download const&) = delete;
+	auto operator=(ranged_download const&) -> ranged_download& = delete;
+
+	~ranged_download() noexcept
+	{
+		::close(_fd);
+	}
+
+	/**
+	 * Download the object.
+	 *
+	 * @throws curl::code of the first range that failed for good, or
+	 *         CURLE_RANGE_ERROR if the server ignored a range, or
+	 *         CURLE_PARTIAL_FILE if the total length does not match.
+	 * @throws curl::mcode
+	 * @throws std::system_error
+	 * @throws std::runtime_error
+	 */
+	void run()
+	{
+		probe();
+		split();
+		multi m;
+		Loop loop(m);
+		_remaining = _parts.size();
+		for (auto& p : _parts) {
+			start(m, *p);
+		}
+		while (_remaining > 0) {
+			loop.run_once();
+			m.dispatch();
+		}
+		finish();
+	}
+
+	/**
+	 * @returns size of the object, known after run().
+	 */
+	auto size() const noexcept -> size_t
+	{
+		return _size;
+	}
+
+	/**
+	 * @returns outcome of every range, after run().
+	 */
+	auto ranges() const -> std::vector<range_stats>
+	{
+		std::vector<range_stats> v;
+		v.reserve(_parts.size());
+		for (auto& p : _parts) {
+			auto secs = std::chrono::duration<double>(p->elapsed).count();
+			v.push_back({ p->offset, p->length, p->written, p->attempts,
+			              p->elapsed, secs > 0 ? p->written / secs : 0.0,
+			              p->result });
+		}
+		return v;
+	}
+
+private:
+	static constexpr size_t unknown = ~size_t(0);
+
+	/**
+	 * One range, fetched with its own easy handle.
+	 */
+	struct part : easy_base<part> {
+		using easy_base<part>::easy_base;
+
+		auto on(easy_ref::write w) noexcept -> size_t
+		{
+			if (!checked) {
+				// the status is final once the body starts.
+				try {
+					checked  = true;
+					accepted = owner->accepts(*this, this->response_code());
+				} catch (curl::code const&) {
+				}
+			}
+			if (!accepted) {
+				return 0;
+			}
+			if (length != unknown && written + pending + w.size() > length) {
+				// more than asked for, so the range was ignored.
+				return 0;
+			}
+			pending += w.size();
+			return sink->on(w);
+		}
+
+		ranged_download*          owner    = nullptr;
+		size_t                    offset   = 0;
+		size_t                    length   = unknown;
+		size_t                    written  = 0;
+		size_t                    pending  = 0;
+		size_t                    attempts = 0;
+		bool                      checked  = false;
+		bool                      accepted = false;
+		std::chrono::microseconds elapsed{0};
+		code                      result   = CURLE_OK;
+		std::unique_ptr<pwrite_sink> sink;
+		curl::completion          done{&finished, this};
+	};
+
+	void probe()
+	{
+		auto head = _proto->make();
+		head.no_body(true);
+		head.perform();
+		// a server that refuses HEAD may still serve the object.
+		auto status = head.response_code();
+		auto length = head.content_length_download();
+		_size = status >= 200 && status < 300 && length >= 0
+		      ? static_cast<size_t>(length) : unknown;
+		_url  = head.url();
+	}
+
+	void split()
+	{
+		if (_size != unknown && _size > 0) {
+			auto r = ::posix_fallocate(_fd, 0, static_cast<off_t>(_size));
+			if (r == EOPNOTSUPP || r == EINVAL) {
+				r = ::ftruncate(_fd, static_cast<off_t>(_size)) == 0 ? 0 : errno;
+			}
+			if (r != 0) {
+				throw std::system_error(r, std::generic_category(), "posix_fallocate");
+			}
+		}
+		// an empty object has nothing to fetch.
+		auto count = _size == 0 ? size_t(0) : size_t(1);
+		auto step  = _size;
+		if (_size != unknown && _size > 0) {
+			auto parts = std::max<size_t>(1, _options.parts);
+			step  = std::max(_options.min_part, (_size + parts - 1) / parts);
+			count = (_size + step - 1) / step;
+		}
+		_parts.clear();
+		for (size_t i = 0; i < count; ++i) {
+			auto p = _proto->make_unique<part>();
+			p->owner  = this;
+			p->offset = i * step;
+			p->length = _size == unknown ? unknown
+			          : std::min(step, _size - p->offset);
+			_parts.push_back(std::move(p));
+		}
+	}
+
+	/**
+	 * Request what is left of p.
+	 */
+	void start(multi_ref m, part& p)
+	{
+		auto from = p.offset + p.written;
+		p.sink.reset(new pwrite_sink(_fd, static_cast<off_t>(from), _options.sink));
+		p.pending  = 0;
+		p.checked  = false;
+		p.accepted = false;
+		p.url(_url);
+		if (p.length != unknown) {
+			auto last = p.offset + p.length - 1;
+			p.range(std::to_string(from) + "-" + std::to_string(last));
+		}
+		++p.attempts;
+		p.done.attach(p);
+		m.add_handle(p);
+	}
+
+	static void finished(void* x, multi_ref::done d)
+	{
+		auto& p = *static_cast<part*>(x);
+		p.owner->finished(p, d);
+	}
+
+	/**
+	 * @returns true iff the body of a response with status belongs in the
+	 *          file at the offset of p.
+	 */
+	auto accepts(part const& p, long status) const noexcept -> bool
+	{
+		if (p.length == unknown) {
+			return status >= 200 && status < 300;
+		}
+		auto whole = p.offset == 0 && p.length == _size;
+		return status == 206 || (status == 200 && whole);
+	}
+
+	void finished(part& p, multi_ref::done d)
+	{
+		auto result = d.result;
+		auto status = p.response_code();
+		auto good   = accepts(p, status);
+		try {
+			p.sink->finish();
+		} catch (std::system_error const&) {
+			result = CURLE_WRITE_ERROR;
+		}
+		if (good) {
+			p.written += p.sink->written();
+		}
+		p.sink.reset();
+		p.elapsed += p.total_time();
+		if (!good && status != 0) {
+			if (!detail::retryable_status(status)) {
+				// a 2xx other than the range means the server ignored
+				// it, which no retry will fix, as with a rejection.
+				p.result = status < 300 ? CURLE_RANGE_ERROR : CURLE_HTTP_RETURNED_ERROR;
+				--_remaining;
+				return;
+			}
+			result = CURLE_HTTP_RETURNED_ERROR;
+		}
+		if (p.length != unknown) {
+			if (!result && p.written != p.length) {
+				result = CURLE_PARTIAL_FILE;
+			}
+		} else if (result) {
+			// without a range the retry starts from the beginning.
+			p.written = 0;
+		}
+		if (result && p.attempts <= _options.retries) {
+			try {
+				start(d.multi, p);
+				return;
+			} catch (std::exception const&) {
+			}
+		}
+		p.result = result;
+		--_remaining;
+	}
+
+	void finish()
+	{
+		auto total = size_t(0);
+		for (auto& p : _parts) {
+			if (p->result) {
+				throw p->result;
+			}
+			total += p->written;
+		}
+		if (_size == unknown) {
+			_size = total;
+			_parts.front()->length = total;
+			if (::ftruncate(_fd, static_cast<off_t>(total)) != 0) {
+				throw std::system_error(errno, std::generic_category(), "ftruncate");
+			}
+		} else if (total != _size) {
+			throw code(CURLE_PARTIAL_FILE);
+		}
+	}
+
+	prototype const*                   _proto;
+	options                            _options;
+	int                                _fd;
+	size_t                             _size = unknown;
+	std::string                        _url;
+	std::vector<std::unique_ptr<part>> _parts;
+	size_t                             _remaining = 0;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_RANGED_DOWNLOAD_HPP
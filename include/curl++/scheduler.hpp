@@ -0,0 +1,445 @@
+#ifndef CURLPLUSPLUS_SCHEDULER_HPP
+#define CURLPLUSPLUS_SCHEDULER_HPP
+#include "completion.hpp"
+#include "easy.hpp"
+#include "host_router.hpp"
+#include "multi.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace curl {
+
+/**
+ * Per host limit of a scheduler that never changes.
+ */
+struct fixed_limit {
+	size_t per_host = 6;
+
+	/**
+	 * @returns number of transfers host may run at once.
+	 */
+	auto limit(host_key) const noexcept -> size_t
+	{
+		return per_host;
+	}
+
+	/**
+	 * Called with every finished transfer of host, and the number of
+	 * transfers host was running including it.
+	 */
+	void update(host_key, easy_ref, code, size_t) noexcept
+	{}
+};
+
+/**
+ * Admits requests into a multi handle within global and per host limits,
+ * holding the rest in queues.
+ *
+ * Requests are either interactive or bulk. Interactive requests are
+ * admitted first, and bulk requests may only take up to max_bulk of the
+ * running slots, so interactive requests never wait behind a large crawl.
+ * Bulk requests still get min_bulk slots while interactive ones wait, so
+ * they are not starved either.
+ *
+ * Within a priority each host has its own queue, and hosts take turns, so
+ * one host with a long queue does not hold back the others.
+ *
+ * example usage:
+ * @code
+ *   curl::scheduler<> s(m);
+ *   s.submit(e, curl::host_key::from_url(url), curl::scheduler<>::bulk,
+ *     [](curl::easy_ref e, curl::code c, curl::scheduler<>::timings t) {
+ *       ...
+ *     });
+ *   while (s.queued() + s.running() > 0) {
+ *     loop.run_once(s.timeout());
+ *     m.dispatch();
+ *     s.expire();
+ *   }
+ * @endcode
+ *
+ * Callbacks are invoked from multi_ref::dispatch() after the handle has
+ * been removed from the multi handle, or from submit() and expire() when a
+ * request expires or cannot be added. The scheduler admits more requests
+ * as soon as one finishes, and expires queued requests whenever it admits,
+ * so it only needs expire() from the loop to meet deadlines while nothing
+ * finishes.
+ *
+ * The multi handle's max_host_connections and max_total_connections should
+ * not be lower than the scheduler's limits, otherwise requests wait inside
+ * libcurl where their priority is not known.
+ *
+ * @param Limit per host limit, such as fixed_limit or adaptive_limit.
+ * @warning easy handles must stay valid until their callback is invoked,
+ *          and their CURLOPT_PRIVATE is used by the scheduler while they run.
+ */
+template<typename Limit = fixed_limit>
+struct scheduler {
+	using clock = std::chrono::steady_clock;
+
+	enum priority {
+		interactive,
+		bulk,
+	};
+
+	/**
+	 * Time a request spent waiting in the scheduler, and running in the
+	 * multi handle.
+	 */
+	struct timings {
+		clock::duration queued;
+		clock::duration transfer;
+	};
+
+	using callback = std::function<void(easy_ref, code, timings)>;
+
+	/**
+	 * Limits on running requests.
+	 */
+	struct limits {
+		size_t max_total = 64; // running requests.
+		size_t max_bulk  = 48; // running bulk requests.
+		size_t min_bulk  = 4;  // running bulk requests while interactive wait.
+	};
+
+	/**
+	 * @param m multi handle to add requests to.
+	 * @param l global limits.
+	 * @param host_limit per host limits.
+	 */
+	explicit scheduler(multi_ref m, limits l = limits(),
+	                   Limit host_limit = Limit())
+	: _multi(m)
+	, _limits(l)
+	, _limit(std::move(host_limit))
+	{}
+
+	scheduler(scheduler const&) = delete;
+	auto operator=(scheduler const&) -> scheduler& = delete;
+
+	/**
+	 * Abandon queued requests and remove running ones from the multi
+	 * handle, without invoking their callbacks.
+	 */
+	~scheduler() noexcept
+	{
+		for (auto& a : _active) {
+			::curl_multi_remove_handle(_multi.raw(), a.request.handle.raw());
+		}
+	}
+
+	/**
+	 * Queue a request, and admit it right away if there is room.
+	 *
+	 * If deadline passes before the request is admitted, it completes with
+	 * CURLE_OPERATION_TIMEDOUT without running, at the next call to
+	 * submit() or expire() or the next completion. Otherwise the time left
+	 * is set as its CURLOPT_TIMEOUT_MS when it is admitted, replacing any
+	 * timeout set on e, so give the deadline as the earlier of the two.
+	 *
+	 * @param e handle with its options set.
+	 * @param host host of the url of e.
+	 * @param p priority of the request.
+	 * @param cb invoked with the result once the request is done.
+	 * @param deadline time by which the request must be done.
+	 * @throws std::bad_alloc
+	 */
+	void submit(easy_ref e, host_key host, priority p, callback cb,
+	            clock::time_point deadline = clock::time_point::max())
+	{
+		auto& h = _hosts[host.hash];
+		h.key = host;
+		h.queue[p].push_back({ e, std::move(cb), clock::now(), deadline });
+		if (h.queue[p].size() == 1) {
+			_ring[p].push_back(&h);
+		}
+		++_queued;
+		_earliest = std::min(_earliest, deadline);
+		admit();
+	}
+
+	/**
+	 * Complete queued requests whose deadline has passed with
+	 * CURLE_OPERATION_TIMEDOUT, whether or not their host has room.
+	 *
+	 * @returns number of requests expired.
+	 */
+	auto expire() -> size_t
+	{
+		auto now = clock::now();
+		if (now < _earliest) {
+			return 0;
+		}
+		std::vector<pending> expired;
+		_earliest = clock::time_point::max();
+		for (auto it = _hosts.begin(); it != _hosts.end(); ) {
+			auto& h = it->second;
+			for (auto p : { interactive, bulk }) {
+				auto& q = h.queue[p];
+				if (q.empty()) {
+					continue;
+				}
+				for (auto r = q.begin(); r != q.end(); ) {
+					if (r->deadline <= now) {
+						expired.push_back(std::move(*r));
+						r = q.erase(r);
+					} else {
+						_earliest = std::min(_earliest, r->deadline);
+						++r;
+					}
+				}
+				if (q.empty()) {
+					auto& ring = _ring[p];
+					ring.erase(std::find(ring.begin(), ring.end(), &h));
+				}
+			}
+			if (h.running == 0 && h.queue[interactive].empty() && h.queue[bulk].empty()) {
+				it = _hosts.erase(it);
+			} else {
+				++it;
+			}
+		}
+		_queued -= expired.size();
+		// callbacks may submit more, so only once the queues are settled.
+		for (auto& r : expired) {
+			auto t  = timings{ now - r.submitted, clock::duration::zero() };
+			auto cb = std::move(r.done);
+			cb(r.handle, CURLE_OPERATION_TIMEDOUT, t);
+		}
+		return expired.size();
+	}
+
+	/**
+	 * @returns time until the earliest deadline of a queued request, for
+	 *          bounding how long the loop waits before calling expire(),
+	 *          or -1 if no queued request has a deadline.
+	 */
+	auto timeout() const noexcept -> std::chrono::milliseconds
+	{
+		if (_earliest == clock::time_point::max()) {
+			return std::chrono::milliseconds(-1);
+		}
+		auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+			_earliest - clock::now());
+		// round up, so the wait does not end just before the deadline.
+		return std::max(std::chrono::milliseconds(0), left + std::chrono::milliseconds(1));
+	}
+
+	/**
+	 * @returns number of requests waiting to be admitted.
+	 */
+	auto queued() const noexcept -> size_t
+	{
+		return _queued;
+	}
+
+	/**
+	 * @returns number of requests running in the multi handle.
+	 */
+	auto running() const noexcept -> size_t
+	{
+		return _running[interactive] + _running[bulk];
+	}
+
+	/**
+	 * @returns number of running requests of priority p.
+	 */
+	auto running(priority p) const noexcept -> size_t
+	{
+		return _running[p];
+	}
+
+	/**
+	 * @returns per host limit, for tuning.
+	 */
+	auto host_limit() noexcept -> Limit&
+	{
+		return _limit;
+	}
+
+private:
+	struct pending {
+		easy_ref          handle;
+		callback          done;
+		clock::time_point submitted;
+		clock::time_point deadline;
+	};
+
+	struct host {
+		host_key            key;
+		size_t              running = 0;
+		std::deque<pending> queue[2];
+	};
+
+	/**
+	 * Request added to the multi handle, attached as its completion.
+	 */
+	struct running_request {
+		running_request(scheduler& s, host& h, priority p, pending r,
+		                clock::time_point now)
+		: owner(&s)
+		, origin(&h)
+		, prio(p)
+		, request(std::move(r))
+		, admitted(now)
+		{}
+
+		void on(multi_ref::done d)
+		{
+			owner->finish(*this, d.result);
+		}
+
+		scheduler*                                     owner;
+		host*                                          origin;
+		priority                                       prio;
+		pending                                        request;
+		clock::time_point                              admitted;
+		typename std::list<running_request>::iterator self;
+		curl::completion                               completion{this};
+	};
+
+	/**
+	 * Admit requests until the limits are reached or nothing is left
+	 * that may run.
+	 */
+	void admit()
+	{
+		if (_admitting) {
+			return;
+		}
+		_admitting = true;
+		try {
+			expire();
+			while (running() < _limits.max_total) {
+				auto bulk_first = _running[bulk] < _limits.min_bulk;
+				if (bulk_first && start_next(bulk)) {
+					continue;
+				}
+				if (start_next(interactive)) {
+					continue;
+				}
+				if (!bulk_first && _running[bulk] < _limits.max_bulk
+				 && start_next(bulk)) {
+					continue;
+				}
+				break;
+			}
+		} catch (...) {
+			_admitting = false;
+			throw;
+		}
+		_admitting = false;
+	}
+
+	/**
+	 * Start the next request of the first host in turn that is below its
+	 * limit.
+	 *
+	 * @returns false if no host could start a request.
+	 */
+	auto start_next(priority p) -> bool
+	{
+		auto& ring = _ring[p];
+		for (auto n = ring.size(); n > 0; --n) {
+			auto h = ring.front();
+			ring.pop_front();
+			if (h->running >= _limit.limit(h->key)) {
+				ring.push_back(h);
+				continue;
+			}
+			auto r = std::move(h->queue[p].front());
+			h->queue[p].pop_front();
+			--_queued;
+			if (!h->queue[p].empty()) {
+				ring.push_back(h);
+			}
+			auto now = clock::now();
+			if (r.deadline <= now) {
+				auto t = timings{ now - r.submitted, clock::duration::zero() };
+				auto cb = std::move(r.done);
+				release(*h);
+				cb(r.handle, CURLE_OPERATION_TIMEDOUT, t);
+			} else {
+				start(*h, p, std::move(r), now);
+			}
+			return true;
+		}
+		return false;
+	}
+
+	void start(host& h, priority p, pending r, clock::time_point now)
+	{
+		auto it = _active.emplace(_active.end(), *this, h, p, std::move(r), now);
+		it->self = it;
+		++h.running;
+		++_running[p];
+		try {
+			auto& q = it->request;
+			if (q.deadline != clock::time_point::max()) {
+				auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+					q.deadline - now);
+				q.handle.setopt(CURLOPT_TIMEOUT_MS, std::max(1L, long(left.count())));
+			}
+			it->completion.attach(q.handle);
+			_multi.add_handle(q.handle);
+		} catch (std::exception const&) {
+			auto t  = timings{ now - it->request.submitted, clock::duration::zero() };
+			auto cb = std::move(it->request.done);
+			auto e  = it->request.handle;
+			--h.running;
+			--_running[p];
+			_active.erase(it);
+			release(h);
+			cb(e, CURLE_FAILED_INIT, t);
+		}
+	}
+
+	void finish(running_request& r, code result)
+	{
+		auto now = clock::now();
+		auto t   = timings{ r.admitted - r.request.submitted, now - r.admitted };
+		auto cb  = std::move(r.request.done);
+		auto e   = r.request.handle;
+		auto& h  = *r.origin;
+		_limit.update(h.key, e, result, h.running);
+		--h.running;
+		--_running[r.prio];
+		_active.erase(r.self);
+		release(h);
+		cb(e, result, t);
+		admit();
+	}
+
+	/**
+	 * Forget a host that has nothing queued or running.
+	 */
+	void release(host& h)
+	{
+		if (h.running == 0 && h.queue[interactive].empty() && h.queue[bulk].empty()) {
+			_hosts.erase(h.key.hash);
+		}
+	}
+
+	multi_ref                            _multi;
+	limits                               _limits;
+	Limit                                _limit;
+	std::unordered_map<uint64_t, host>   _hosts;
+	std::deque<host*>                    _ring[2];
+	std::list<running_request>           _active;
+	size_t                               _queued = 0;
+	size_t                               _running[2] = { 0, 0 };
+	clock::time_point                    _earliest = clock::time_point::max();
+	bool                                 _admitting = false;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_SCHEDULER_HPP
@@ -73,7 +73,7 @@ struct share_ref
 	template<typename T>
 	void setopt(CURLSHoption o, T x)
 	{
-		invoke(::curl_share_setopt, _handle, o, x);
+		curl::invoke(::curl_share_setopt, _handle, o, x);
 	}
 
 	/**
@@ -0,0 +1,177 @@
+#ifndef CURLPLUSPLUS_SIZED_BODY_HPP
+#define CURLPLUSPLUS_SIZED_BODY_HPP
+#include "buffer.hpp"
+#include "chunked_body.hpp"
+#include "easy.hpp"
+#include "header_line.hpp"
+
+#include <cstddef>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace curl {
+
+/**
+ * Response body that is stored in one allocation of exactly the announced
+ * size when the response carries Content-Length.
+ *
+ * Content-Length is picked up from the header events, and the storage is
+ * reserved at the first write event, so responses without a body never
+ * allocate. Responses of unknown length, such as chunked ones, are stored
+ * in a chunked_body instead. Every status line starts over, so only the
+ * headers of the final response of a redirect count.
+ *
+ * example usage:
+ * @code
+ *   struct request : curl::easy_base<request> {
+ *     curl::sized_body body;
+ *     auto on(header h) noexcept -> size_t { return body.on(h); }
+ *     auto on(write w) noexcept -> size_t { return body.on(w); }
+ *   };
+ *   ...
+ *   if (r.body.contiguous()) {
+ *     parse(r.body.buffer());
+ *   }
+ * @endcode
+ */
+struct sized_body {
+	/**
+	 * @param max_reserve most bytes reserved up front, whatever the
+	 *        response claims.
+	 */
+	explicit sized_body(size_t max_reserve = 64 * 1024 * 1024) noexcept
+	: _max_reserve(max_reserve)
+	{}
+
+	/**
+	 * Look for the status line and Content-Length, for use as a handler of
+	 * header events.
+	 */
+	auto on(easy_ref::header h) noexcept -> size_t
+	{
+		if (detail::is_status_line(h)) {
+			clear();
+		} else {
+			auto n = detail::content_length(h);
+			if (n != unknown) {
+				_expected = n;
+			}
+		}
+		return h.size();
+	}
+
+	/**
+	 * Append the received data, for use as a handler of write events.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		try {
+			append(w);
+			return w.size();
+		} catch (std::bad_alloc const&) {
+			// fails the transfer with CURLE_WRITE_ERROR.
+			return 0;
+		}
+	}
+
+	/**
+	 * Append b, reserving storage on the first call.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void append(const_buffer b)
+	{
+		if (!_started) {
+			_started = true;
+			_contiguous = _expected != unknown;
+			if (_contiguous) {
+				_data.reserve(_expected < _max_reserve ? _expected : _max_reserve);
+			}
+		}
+		if (_contiguous) {
+			// grows past the reservation only when the length was
+			// wrong, such as for decoded content.
+			_data.insert(_data.end(), b.begin(), b.end());
+		} else {
+			_chunks.append(b);
+		}
+	}
+
+	/**
+	 * Drop the contents and forget the expected length.
+	 */
+	void clear() noexcept
+	{
+		_data.clear();
+		_data.shrink_to_fit();
+		_chunks.clear();
+		_expected   = unknown;
+		_started    = false;
+		_contiguous = false;
+	}
+
+	/**
+	 * @returns true iff the contents are stored in one buffer.
+	 */
+	auto contiguous() const noexcept -> bool
+	{
+		return _contiguous;
+	}
+
+	/**
+	 * @returns the contents.
+	 * @pre contiguous()
+	 */
+	auto buffer() const noexcept -> const_buffer
+	{
+		return { _data.data(), _data.size() };
+	}
+
+	/**
+	 * @returns the contents.
+	 * @pre !contiguous()
+	 */
+	auto chunks() const noexcept -> chunked_body const&
+	{
+		return _chunks;
+	}
+
+	/**
+	 * @returns Content-Length of the response, if it had one.
+	 */
+	auto expected() const noexcept -> size_t
+	{
+		return _expected;
+	}
+
+	auto size() const noexcept -> size_t
+	{
+		return _contiguous ? _data.size() : _chunks.size();
+	}
+
+	/**
+	 * @returns the contents as a string.
+	 * @throws std::bad_alloc
+	 */
+	auto str() const -> std::string
+	{
+		return _contiguous ? std::string(_data.begin(), _data.end()) : _chunks.str();
+	}
+
+	/**
+	 * Length of a response without Content-Length.
+	 */
+	static constexpr size_t unknown = detail::unknown_length;
+
+private:
+	std::vector<char> _data;
+	chunked_body      _chunks;
+	size_t            _max_reserve;
+	size_t            _expected   = unknown;
+	bool              _started    = false;
+	bool              _contiguous = false;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_SIZED_BODY_HPP
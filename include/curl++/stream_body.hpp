@@ -0,0 +1,193 @@
+#ifndef CURLPLUSPLUS_STREAM_BODY_HPP
+#define CURLPLUSPLUS_STREAM_BODY_HPP
+#include "buffer.hpp"
+#include "byte_ring.hpp"
+#include "easy.hpp"
+#include "multi.hpp"
+#include "submission_queue.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <curl/curl.h>
+
+namespace curl {
+
+/**
+ * Response body streamed to a consumer thread through a bounded ring, so
+ * memory stays flat however large the response is.
+ *
+ * Write events are copied into the ring on the thread running the multi
+ * handle. When the ring cannot take a write event, the transfer is paused
+ * with CURL_WRITEFUNC_PAUSE, and the consumer resumes it through the
+ * submission queue once it has read enough to make room for it.
+ *
+ * The ring holds at least CURL_MAX_WRITE_SIZE bytes, as libcurl delivers
+ * a paused write event again in pieces of up to that size.
+ *
+ * example usage:
+ * @code
+ *   curl::submission_queue<curl::epoll_loop> queue(m, loop);
+ *   curl::stream_body<curl::epoll_loop> body(queue);
+ *   curl::completion done{&body};
+ *   body.attach(e);
+ *   done.attach(e);
+ *   queue.add(e);
+ *   // consumer thread
+ *   char buf[65536];
+ *   while (auto n = body.read({ buf, sizeof buf })) {
+ *     process(buf, n);
+ *   }
+ *   if (body.result()) { ... }
+ *   // loop thread
+ *   loop.run_once();
+ *   queue.drain();
+ *   m.dispatch();
+ * @endcode
+ *
+ * @param Waker waker of the submission queue resuming the transfer.
+ */
+template<typename Waker>
+struct stream_body {
+	/**
+	 * @param queue submission queue of the multi handle running the
+	 *        transfer.
+	 * @param capacity size of the ring, rounded up to a power of two.
+	 * @throws std::bad_alloc
+	 */
+	explicit stream_body(submission_queue<Waker>& queue, size_t capacity = 1024 * 1024)
+	: _queue(&queue)
+	, _ring(std::max<size_t>(capacity, CURL_MAX_WRITE_SIZE))
+	{}
+
+	stream_body(stream_body const&) = delete;
+	auto operator=(stream_body const&) -> stream_body& = delete;
+
+	/**
+	 * Stream the body of e, which is resumed through the queue.
+	 *
+	 * @throws curl::code
+	 */
+	void attach(easy_ref e)
+	{
+		e.set_handler<easy_ref::write>(this);
+		_handle = e;
+	}
+
+	/**
+	 * Copy the received data into the ring, for use as a handler of write
+	 * events on the thread running the multi handle.
+	 *
+	 * @returns CURL_WRITEFUNC_PAUSE if the ring is too full.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		if (w.size() > _ring.capacity()) {
+			// would never fit.
+			return 0;
+		}
+		if (_ring.space() < w.size()) {
+			_wanted.store(w.size(), std::memory_order_relaxed);
+			_paused.store(true);
+			// the consumer may have made room before seeing the
+			// flag, in which case nobody would resume the transfer.
+			if (_ring.space() < w.size() || !_paused.exchange(false)) {
+				return CURL_WRITEFUNC_PAUSE;
+			}
+		}
+		_ring.push(w.data(), w.size());
+		_waiter.notify();
+		return w.size();
+	}
+
+	/**
+	 * End the stream with the result of the transfer, for use as a
+	 * completion handler.
+	 */
+	void on(multi_ref::done d) noexcept
+	{
+		_result = d.result;
+		_closed.store(true);
+		_waiter.notify();
+	}
+
+	/**
+	 * Copy available data into b without waiting.
+	 * Must only be called from the consumer thread.
+	 *
+	 * @returns number of bytes copied, 0 if none are available.
+	 */
+	auto try_read(mutable_buffer b) -> size_t
+	{
+		auto n = _ring.pop(b.data(), b.size());
+		// resume only once the paused write event fits, rather than
+		// after every read.
+		if (n > 0 && _paused.load()
+		 && _ring.space() >= _wanted.load(std::memory_order_relaxed)
+		 && _paused.exchange(false)) {
+			_queue->resume(_handle);
+		}
+		return n;
+	}
+
+	/**
+	 * Copy data into b, waiting until some is available or the transfer
+	 * has finished.
+	 * Must only be called from the consumer thread.
+	 *
+	 * @returns number of bytes copied, 0 at the end of the stream.
+	 */
+	auto read(mutable_buffer b) -> size_t
+	{
+		while (true) {
+			if (auto n = try_read(b)) {
+				return n;
+			}
+			if (_closed.load()) {
+				// data may have arrived before the transfer ended.
+				return try_read(b);
+			}
+			_waiter.wait([this] { return _ring.size() > 0 || _closed.load(); });
+		}
+	}
+
+	/**
+	 * @returns true iff the transfer has finished, though data may still
+	 *          be left to read.
+	 */
+	auto closed() const noexcept -> bool
+	{
+		return _closed.load();
+	}
+
+	/**
+	 * @returns result of the transfer.
+	 * @pre closed()
+	 */
+	auto result() const noexcept -> code
+	{
+		return _result;
+	}
+
+	/**
+	 * @returns size of the ring.
+	 */
+	auto capacity() const noexcept -> size_t
+	{
+		return _ring.capacity();
+	}
+
+private:
+	submission_queue<Waker>* _queue;
+	easy_ref                 _handle;
+	detail::byte_ring        _ring;
+	detail::thread_waiter    _waiter;
+	code                     _result = CURLE_OK;
+	std::atomic<size_t>      _wanted{0};
+	std::atomic<bool>        _paused{false};
+	std::atomic<bool>        _closed{false};
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_STREAM_BODY_HPP
@@ -0,0 +1,216 @@
+#ifndef CURLPLUSPLUS_STREAM_SOURCE_HPP
+#define CURLPLUSPLUS_STREAM_SOURCE_HPP
+#include "buffer.hpp"
+#include "byte_ring.hpp"
+#include "easy.hpp"
+#include "multi.hpp"
+#include "submission_queue.hpp"
+#include "types.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <curl/curl.h>
+
+namespace curl {
+
+/**
+ * Upload body produced on another thread while it is being sent, through a
+ * bounded ring, so memory stays bounded by the ring however large the body
+ * is.
+ *
+ * Read events take data from the ring on the thread running the multi
+ * handle. When the ring is empty, the transfer is paused with
+ * CURL_READFUNC_PAUSE, and the producer resumes it through the submission
+ * queue once it has written more or closed the stream. A producer writing
+ * to a full ring waits for the transfer to take some.
+ *
+ * Without a known size the body is sent with chunked transfer encoding.
+ *
+ * example usage:
+ * @code
+ *   curl::submission_queue<curl::epoll_loop> queue(m, loop);
+ *   curl::stream_source<curl::epoll_loop> body(queue);
+ *   curl::completion done{&body};
+ *   e.url(url);
+ *   body.attach(e);
+ *   done.attach(e);
+ *   queue.add(e);
+ *   // producer thread
+ *   while (auto batch = compress_next()) {
+ *     if (!body.write(batch)) {
+ *       break; // the transfer ended early.
+ *     }
+ *   }
+ *   body.close();
+ * @endcode
+ *
+ * @param Waker waker of the submission queue resuming the transfer.
+ */
+template<typename Waker>
+struct stream_source {
+	/**
+	 * Size of a body that is not known up front.
+	 */
+	static constexpr curl_off_t unknown = -1;
+
+	/**
+	 * @param queue submission queue of the multi handle running the
+	 *        transfer.
+	 * @param capacity size of the ring, rounded up to a power of two.
+	 * @throws std::bad_alloc
+	 */
+	explicit stream_source(submission_queue<Waker>& queue, size_t capacity = 1024 * 1024)
+	: _queue(&queue)
+	, _ring(capacity)
+	{}
+
+	stream_source(stream_source const&) = delete;
+	auto operator=(stream_source const&) -> stream_source& = delete;
+
+	/**
+	 * Upload the stream with e, which is resumed through the queue.
+	 * Sets up e for an upload, which libcurl sends as PUT; set
+	 * CURLOPT_CUSTOMREQUEST on e for another method such as POST.
+	 *
+	 * @param size of the body if known, otherwise it is sent chunked.
+	 * @throws curl::code
+	 */
+	void attach(easy_ref e, curl_off_t size = unknown)
+	{
+		e.set_handler<easy_ref::read>(this);
+		e.setopt(CURLOPT_UPLOAD, 1L);
+		e.setopt(CURLOPT_INFILESIZE_LARGE, size);
+		_handle = e;
+	}
+
+	/**
+	 * Copy data from the ring, for use as a handler of read events on the
+	 * thread running the multi handle.
+	 *
+	 * @returns CURL_READFUNC_PAUSE if the ring is empty, 0 at the end.
+	 */
+	auto on(easy_ref::read r) noexcept -> size_t
+	{
+		auto n = _ring.pop(r.data(), r.size());
+		if (n == 0 && _closed.load()) {
+			// the last write and close may both have happened after the
+			// pop, so the ring is only known to be drained now.
+			n = _ring.pop(r.data(), r.size());
+		} else if (n == 0) {
+			_paused.store(true);
+			// the producer may have written before seeing the flag,
+			// in which case nobody would resume the transfer.
+			if ((_ring.size() == 0 && !_closed.load()) || !_paused.exchange(false)) {
+				return CURL_READFUNC_PAUSE;
+			}
+			n = _ring.pop(r.data(), r.size());
+		}
+		_waiter.notify();
+		return n;
+	}
+
+	/**
+	 * Stop the producer with the result of the transfer, for use as a
+	 * completion handler.
+	 */
+	void on(multi_ref::done d) noexcept
+	{
+		_result = d.result;
+		_done.store(true);
+		_waiter.notify();
+	}
+
+	/**
+	 * Copy as much of b as fits without waiting.
+	 * Must only be called from the producer thread.
+	 *
+	 * @returns number of bytes copied.
+	 */
+	auto try_write(const_buffer b) -> size_t
+	{
+		auto n = _ring.push(b.data(), b.size());
+		if (n > 0) {
+			resume();
+		}
+		return n;
+	}
+
+	/**
+	 * Copy all of b, waiting for the transfer to make room as needed.
+	 * Must only be called from the producer thread.
+	 *
+	 * @returns false if the transfer ended before all of b was copied.
+	 */
+	auto write(const_buffer b) -> bool
+	{
+		auto p = b.data();
+		auto n = b.size();
+		while (n > 0) {
+			if (_done.load()) {
+				return false;
+			}
+			auto k = try_write({ p, n });
+			p += k;
+			n -= k;
+			if (n > 0) {
+				_waiter.wait([this] { return _ring.space() > 0 || _done.load(); });
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * End the body once the ring has been sent.
+	 * Must only be called from the producer thread.
+	 */
+	void close()
+	{
+		_closed.store(true);
+		resume();
+	}
+
+	/**
+	 * @returns true iff the transfer has finished.
+	 */
+	auto done() const noexcept -> bool
+	{
+		return _done.load();
+	}
+
+	/**
+	 * @returns result of the transfer.
+	 * @pre done()
+	 */
+	auto result() const noexcept -> code
+	{
+		return _result;
+	}
+
+	/**
+	 * @returns size of the ring.
+	 */
+	auto capacity() const noexcept -> size_t
+	{
+		return _ring.capacity();
+	}
+
+private:
+	void resume()
+	{
+		if (_paused.load() && _paused.exchange(false)) {
+			_queue->resume(_handle);
+		}
+	}
+
+	submission_queue<Waker>* _queue;
+	easy_ref                 _handle;
+	detail::byte_ring        _ring;
+	detail::thread_waiter    _waiter;
+	code                     _result = CURLE_OK;
+	std::atomic<bool>        _paused{false};
+	std::atomic<bool>        _closed{false};
+	std::atomic<bool>        _done{false};
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_STREAM_SOURCE_HPP
@@ -0,0 +1,201 @@
+#ifndef CURLPLUSPLUS_SUBMISSION_QUEUE_HPP
+#define CURLPLUSPLUS_SUBMISSION_QUEUE_HPP
+#include "easy.hpp"
+#include "multi.hpp"
+
+#include <atomic>
+#include <exception>
+#include <utility>
+
+namespace curl {
+
+/**
+ * Lock-free queue through which any thread can hand easy handles to the
+ * thread running a multi handle.
+ *
+ * Producers push onto an intrusive stack and wake the loop only when the
+ * stack was empty, so a burst of submissions costs one wakeup. The loop
+ * thread calls drain() after every wakeup to apply them in submission order.
+ *
+ * example usage:
+ * @code
+ *   curl::epoll_loop loop(m);
+ *   curl::submission_queue<curl::epoll_loop> queue(m, loop);
+ *   // any thread
+ *   queue.add(e);
+ *   // loop thread
+ *   while (true) {
+ *     loop.run_once();
+ *     queue.drain();
+ *     ...
+ *   }
+ * @endcode
+ *
+ * @param Waker type with a thread safe wakeup() member function, such as
+ *        epoll_loop, uring_loop or multi_ref when driving it with poll().
+ */
+template<typename Waker>
+struct submission_queue {
+	/**
+	 * Kinds of operation that can be submitted.
+	 */
+	enum operation {
+		add_op,    // multi_ref::add_handle
+		cancel_op, // multi_ref::remove_handle
+		resume_op, // easy_ref::pause(pause_flag::cont)
+	};
+
+	/**
+	 * @param m the multi handle operations are applied to.
+	 * @param waker wakes the thread running m.
+	 */
+	submission_queue(multi_ref m, Waker& waker) noexcept
+	: _multi(m)
+	, _waker(&waker)
+	{}
+
+	submission_queue(submission_queue const&) = delete;
+	auto operator=(submission_queue const&) -> submission_queue& = delete;
+
+	/**
+	 * Discards operations that were never drained.
+	 */
+	~submission_queue() noexcept
+	{
+		auto n = _head.exchange(nullptr, std::memory_order_acquire);
+		while (n != nullptr) {
+			delete std::exchange(n, n->next);
+		}
+	}
+
+	/**
+	 * Submit e to be added to the multi handle.
+	 * Safe to call from any thread.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void add(easy_ref e)
+	{
+		push(add_op, e);
+	}
+
+	/**
+	 * Submit e to be removed from the multi handle, abandoning its
+	 * transfer. Has no effect if e is not part of the multi handle by then.
+	 * Safe to call from any thread.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void cancel(easy_ref e)
+	{
+		push(cancel_op, e);
+	}
+
+	/**
+	 * Submit e to be unpaused, such as once a consumer on another thread
+	 * has made room for the data of a paused write event. e must still
+	 * exist by then.
+	 * Safe to call from any thread.
+	 *
+	 * @throws std::bad_alloc
+	 */
+	void resume(easy_ref e)
+	{
+		push(resume_op, e);
+	}
+
+	/**
+	 * Apply all submitted operations in order.
+	 * Must be called from the thread running the multi handle.
+	 *
+	 * @returns number of operations applied.
+	 * @throws curl::mcode or curl::code for the first operation that
+	 *         failed, after applying the rest.
+	 */
+	auto drain() -> size_t
+	{
+		auto n = _head.exchange(nullptr, std::memory_order_acquire);
+		// restore submission order.
+		node* list = nullptr;
+		while (n != nullptr) {
+			auto next = n->next;
+			n->next = list;
+			list = std::exchange(n, next);
+		}
+		auto count = size_t(0);
+		auto error = std::exception_ptr();
+		while (list != nullptr) {
+			try {
+				apply(*list);
+			} catch (mcode const&) {
+				if (!error) {
+					error = std::current_exception();
+				}
+			} catch (code const&) {
+				if (!error) {
+					error = std::current_exception();
+				}
+			}
+			delete std::exchange(list, list->next);
+			++count;
+		}
+		if (error) {
+			std::rethrow_exception(error);
+		}
+		return count;
+	}
+
+	/**
+	 * @returns true iff there are no submitted operations.
+	 */
+	auto empty() const noexcept -> bool
+	{
+		return _head.load(std::memory_order_relaxed) == nullptr;
+	}
+
+private:
+	struct node {
+		operation op;
+		easy_ref  handle;
+		node*     next;
+	};
+
+	void push(operation op, easy_ref e)
+	{
+		auto n = new node{op, e, nullptr};
+		auto head = _head.load(std::memory_order_relaxed);
+		do {
+			n->next = head;
+		} while (!_head.compare_exchange_weak(head, n,
+			std::memory_order_release, std::memory_order_relaxed));
+		// the loop drains everything after a wakeup, so only the push
+		// onto an empty stack needs one.
+		if (head == nullptr) {
+			_waker->wakeup();
+		}
+	}
+
+	void apply(node const& n)
+	{
+		switch (n.op) {
+		case add_op:
+			_multi.add_handle(n.handle);
+			break;
+		case cancel_op:
+			_multi.remove_handle(n.handle);
+			break;
+		case resume_op:
+			// pause_flag::cont would be odr-used, which needs a
+			// definition before C++17.
+			easy_ref(n.handle).pause({ CURLPAUSE_CONT });
+			break;
+		}
+	}
+
+	multi_ref          _multi;
+	Waker*             _waker;
+	std::atomic<node*> _head{nullptr};
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_SUBMISSION_QUEUE_HPP
@@ -0,0 +1,388 @@
+#ifndef CURLPLUSPLUS_TEE_HPP
+#define CURLPLUSPLUS_TEE_HPP
+#include "buffer.hpp"
+#include "byte_ring.hpp"
+#include "easy.hpp"
+#include "multi.hpp"
+#include "submission_queue.hpp"
+#include "types.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <curl/curl.h>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace curl {
+
+/**
+ * Hands one response body to several consumers, each on its own thread,
+ * such as a disk writer, a hasher and a parser.
+ *
+ * Each write event is copied once into a reference counted chunk, which
+ * every consumer receives in order and which is freed once the last of
+ * them is done with it. The chunks held by consumers are bounded in
+ * number and size, so the slowest consumer pauses the transfer, which is
+ * resumed through the submission queue once it catches up.
+ *
+ * example usage:
+ * @code
+ *   curl::tee<curl::epoll_loop> t(queue, 3);
+ *   curl::completion done{&t};
+ *   t.attach(e);
+ *   done.attach(e);
+ *   queue.add(e);
+ *   // consumer thread i
+ *   while (auto c = t.next(i)) {
+ *     consume(c.buffer());
+ *   }
+ *   if (t.result()) { ... }
+ * @endcode
+ *
+ * @param Waker waker of the submission queue resuming the transfer.
+ */
+template<typename Waker>
+struct tee {
+	struct options {
+		size_t max_bytes  = 4 * 1024 * 1024; // bytes held by consumers.
+		size_t max_chunks = 256;             // chunks held by consumers.
+	};
+
+	/**
+	 * A received chunk, shared by all consumers.
+	 * Moveable, released when destroyed.
+	 */
+	struct chunk_ref {
+		chunk_ref() noexcept = default;
+
+		chunk_ref(chunk_ref&& x) noexcept
+		: _owner(std::exchange(x._owner, nullptr))
+		, _chunk(std::exchange(x._chunk, nullptr))
+		{}
+
+		auto operator=(chunk_ref&& x) noexcept -> chunk_ref&
+		{
+			chunk_ref(std::move(x)).swap(*this);
+			return *this;
+		}
+
+		~chunk_ref() noexcept
+		{
+			if (_chunk != nullptr) {
+				_owner->release(_chunk);
+			}
+		}
+
+		void swap(chunk_ref& x) noexcept
+		{
+			std::swap(_owner, x._owner);
+			std::swap(_chunk, x._chunk);
+		}
+
+		/**
+		 * @returns false at the end of the body.
+		 */
+		explicit operator bool() const noexcept
+		{
+			return _chunk != nullptr;
+		}
+
+		auto data() const noexcept -> const char*
+		{
+			return _chunk->data();
+		}
+
+		auto size() const noexcept -> size_t
+		{
+			return _chunk->size;
+		}
+
+		auto buffer() const noexcept -> const_buffer
+		{
+			return { _chunk->data(), _chunk->size };
+		}
+
+	private:
+		friend tee;
+
+		chunk_ref(tee* owner, typename tee::chunk* c) noexcept
+		: _owner(owner)
+		, _chunk(c)
+		{}
+
+		tee*                 _owner = nullptr;
+		typename tee::chunk* _chunk = nullptr;
+	};
+
+	/**
+	 * @param queue submission queue of the multi handle running the
+	 *        transfer.
+	 * @param consumers number of consumers, each receiving every chunk.
+	 * @throws std::bad_alloc
+	 */
+	tee(submission_queue<Waker>& queue, size_t consumers)
+	: tee(queue, consumers, options())
+	{}
+
+	/**
+	 * @throws std::bad_alloc
+	 */
+	tee(submission_queue<Waker>& queue, size_t consumers, options o)
+	: _queue(&queue)
+	, _options(o)
+	, _lanes(consumers)
+	{
+		_options.max_chunks = std::max<size_t>(1, _options.max_chunks);
+		for (auto& l : _lanes) {
+			l.reset(new lane(_options.max_chunks));
+		}
+	}
+
+	tee(tee const&) = delete;
+	auto operator=(tee const&) -> tee& = delete;
+
+	/**
+	 * Frees chunks that were never consumed.
+	 * @pre no chunk_ref is left.
+	 */
+	~tee() noexcept
+	{
+		for (auto& l : _lanes) {
+			while (auto c = l->pop()) {
+				if (c->refs.fetch_sub(1) == 1) {
+					std::free(c);
+				}
+			}
+		}
+	}
+
+	/**
+	 * Fan out the body of e, which is resumed through the queue.
+	 *
+	 * @throws curl::code
+	 */
+	void attach(easy_ref e)
+	{
+		e.set_handler<easy_ref::write>(this);
+		_handle = e;
+	}
+
+	/**
+	 * Hand the received data to every consumer, for use as a handler of
+	 * write events on the thread running the multi handle.
+	 *
+	 * @returns CURL_WRITEFUNC_PAUSE if the consumers hold too much.
+	 */
+	auto on(easy_ref::write w) noexcept -> size_t
+	{
+		if (_lanes.empty()) {
+			return w.size();
+		}
+		if (!admit(w.size())) {
+			_wanted.store(w.size(), std::memory_order_relaxed);
+			_paused.store(true);
+			// consumers may have released chunks before seeing the
+			// flag, in which case nobody would resume the transfer.
+			if (!admit(w.size()) || !_paused.exchange(false)) {
+				return CURL_WRITEFUNC_PAUSE;
+			}
+		}
+		auto c = static_cast<chunk*>(std::malloc(sizeof(chunk) + w.size()));
+		if (c == nullptr) {
+			return 0;
+		}
+		new (c) chunk{ { _lanes.size() }, w.size() };
+		std::memcpy(c->data(), w.data(), w.size());
+		_bytes.fetch_add(w.size());
+		_chunks.fetch_add(1);
+		for (auto& l : _lanes) {
+			// cannot be full, as no more chunks are held than fit.
+			l->push(c);
+		}
+		return w.size();
+	}
+
+	/**
+	 * End the body with the result of the transfer, for use as a
+	 * completion handler.
+	 */
+	void on(multi_ref::done d) noexcept
+	{
+		_result = d.result;
+		_closed.store(true);
+		for (auto& l : _lanes) {
+			l->waiter.notify();
+		}
+	}
+
+	/**
+	 * Take the next chunk of consumer i without waiting.
+	 * Must only be called from the thread of consumer i.
+	 *
+	 * @returns the chunk, or an empty chunk_ref if none is available.
+	 */
+	auto try_next(size_t i) noexcept -> chunk_ref
+	{
+		return { this, _lanes[i]->pop() };
+	}
+
+	/**
+	 * Take the next chunk of consumer i, waiting until one is available
+	 * or the transfer has finished.
+	 * Must only be called from the thread of consumer i.
+	 *
+	 * @returns the chunk, or an empty chunk_ref at the end of the body.
+	 */
+	auto next(size_t i) -> chunk_ref
+	{
+		auto& l = *_lanes[i];
+		while (true) {
+			if (auto c = l.pop()) {
+				return { this, c };
+			}
+			if (_closed.load()) {
+				// chunks may have arrived before the transfer ended.
+				return { this, l.pop() };
+			}
+			l.waiter.wait([&] { return !l.empty() || _closed.load(); });
+		}
+	}
+
+	/**
+	 * @returns true iff the transfer has finished, though chunks may still
+	 *          be left to consume.
+	 */
+	auto closed() const noexcept -> bool
+	{
+		return _closed.load();
+	}
+
+	/**
+	 * @returns result of the transfer.
+	 * @pre closed()
+	 */
+	auto result() const noexcept -> code
+	{
+		return _result;
+	}
+
+	/**
+	 * @returns number of consumers.
+	 */
+	auto consumers() const noexcept -> size_t
+	{
+		return _lanes.size();
+	}
+
+private:
+	struct chunk {
+		std::atomic<size_t> refs;
+		size_t              size;
+
+		auto data() noexcept -> char*
+		{
+			return reinterpret_cast<char*>(this + 1);
+		}
+	};
+
+	/**
+	 * Chunks waiting for one consumer, in order.
+	 */
+	struct lane {
+		explicit lane(size_t capacity)
+		: mask(round_up(capacity) - 1)
+		, slots(new chunk*[mask + 1])
+		{}
+
+		void push(chunk* c) noexcept
+		{
+			auto t = tail.load(std::memory_order_relaxed);
+			slots[t & mask] = c;
+			tail.store(t + 1);
+			waiter.notify();
+		}
+
+		auto pop() noexcept -> chunk*
+		{
+			auto h = head.load(std::memory_order_relaxed);
+			if (h == tail.load()) {
+				return nullptr;
+			}
+			auto c = slots[h & mask];
+			head.store(h + 1);
+			return c;
+		}
+
+		auto empty() const noexcept -> bool
+		{
+			return head.load() == tail.load();
+		}
+
+		static auto round_up(size_t n) noexcept -> size_t
+		{
+			auto c = size_t(1);
+			while (c < n) {
+				c *= 2;
+			}
+			return c;
+		}
+
+		size_t                    mask;
+		std::unique_ptr<chunk*[]> slots;
+		std::atomic<size_t>       head{0};
+		std::atomic<size_t>       tail{0};
+		detail::thread_waiter     waiter;
+	};
+
+	/**
+	 * @returns true iff a write event of n bytes may be taken, which a
+	 *          single one always may.
+	 */
+	auto admit(size_t n) const noexcept -> bool
+	{
+		auto bytes = _bytes.load();
+		return _chunks.load() < _options.max_chunks
+		    && (bytes == 0 || bytes + n <= _options.max_bytes);
+	}
+
+	/**
+	 * Drop one reference to c, from any consumer thread.
+	 */
+	void release(chunk* c) noexcept
+	{
+		if (c->refs.fetch_sub(1) != 1) {
+			return;
+		}
+		_bytes.fetch_sub(c->size);
+		_chunks.fetch_sub(1);
+		std::free(c);
+		if (_paused.load() && admit(_wanted.load(std::memory_order_relaxed))
+		 && _paused.exchange(false)) {
+			try {
+				_queue->resume(_handle);
+			} catch (std::bad_alloc const&) {
+				// let the next release try again.
+				_paused.store(true);
+			}
+		}
+	}
+
+	submission_queue<Waker>*           _queue;
+	options                            _options;
+	std::vector<std::unique_ptr<lane>> _lanes;
+	easy_ref                           _handle;
+	code                               _result = CURLE_OK;
+	std::atomic<size_t>                _bytes{0};
+	std::atomic<size_t>                _chunks{0};
+	std::atomic<size_t>                _wanted{0};
+	std::atomic<bool>                  _paused{false};
+	std::atomic<bool>                  _closed{false};
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_TEE_HPP
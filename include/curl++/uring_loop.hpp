@@ -0,0 +1,471 @@
+#ifndef CURLPLUSPLUS_URING_LOOP_HPP
+#define CURLPLUSPLUS_URING_LOOP_HPP
+#include "multi.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <curl/curl.h>
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <system_error>
+#include <unistd.h>
+#include <vector>
+
+namespace curl {
+
+/**
+ * Event loop driving a multi handle through curl_multi_socket_action using
+ * io_uring.
+ *
+ * Each socket gets a oneshot poll request, re-armed as it completes, and
+ * the timer event is a timeout request on the same ring, so a wakeup with
+ * many ready sockets costs a single io_uring_enter. Pending poll updates
+ * are submitted in the same call that waits for completions. Oneshot polls
+ * check readiness when armed, so a socket that libcurl left writable
+ * without filling it is reported again, which a multishot poll would not.
+ *
+ * Has the same interface as epoll_loop, so either can drive a multi handle.
+ * Use supported() to check for kernel support before constructing one.
+ *
+ * @warning installs itself as the socket and timer handler of the multi
+ * handle, which must outlive the loop.
+ */
+struct uring_loop {
+	/**
+	 * Set up an io_uring instance and install handlers on m.
+	 *
+	 * @param entries submission queue size.
+	 * @throws std::system_error if io_uring is not available.
+	 */
+	explicit uring_loop(multi_ref m, unsigned entries = 256)
+	: _multi(m)
+	{
+		io_uring_params p;
+		std::memset(&p, 0, sizeof p);
+		_ring = setup(entries, &p);
+		if (_ring == -1) {
+			throw std::system_error(errno, std::generic_category(),
+			                        "io_uring_setup");
+		}
+		if (!(p.features & IORING_FEAT_EXT_ARG)) {
+			::close(_ring);
+			throw std::system_error(ENOSYS, std::generic_category(),
+			                        "io_uring_setup");
+		}
+		try {
+			map_rings(p);
+			_wake = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (_wake == -1) {
+				throw std::system_error(errno, std::generic_category(),
+				                        "eventfd");
+			}
+		} catch (...) {
+			unmap_rings();
+			::close(_ring);
+			throw;
+		}
+		arm_wake();
+		_multi.set_handler<multi_ref::socket>(this);
+		_multi.set_handler<multi_ref::timer>(this);
+	}
+
+	uring_loop(uring_loop const&) = delete;
+	auto operator=(uring_loop const&) -> uring_loop& = delete;
+
+	/**
+	 * Uninstall handlers and tear down the ring.
+	 */
+	~uring_loop() noexcept
+	{
+		::curl_multi_setopt(_multi.raw(), CURLMOPT_SOCKETFUNCTION, nullptr);
+		::curl_multi_setopt(_multi.raw(), CURLMOPT_SOCKETDATA, nullptr);
+		::curl_multi_setopt(_multi.raw(), CURLMOPT_TIMERFUNCTION, nullptr);
+		::curl_multi_setopt(_multi.raw(), CURLMOPT_TIMERDATA, nullptr);
+		unmap_rings();
+		::close(_ring);
+		::close(_wake);
+	}
+
+	/**
+	 * @returns true iff the running kernel can host a uring_loop.
+	 */
+	static auto supported() noexcept -> bool
+	{
+		io_uring_params p;
+		std::memset(&p, 0, sizeof p);
+		auto fd = setup(1, &p);
+		if (fd == -1) {
+			return false;
+		}
+		::close(fd);
+		return p.features & IORING_FEAT_EXT_ARG;
+	}
+
+	/**
+	 * Submit pending requests, wait up to timeout for completions and pass
+	 * ready sockets and expired timers to socket_action.
+	 * A negative timeout waits indefinitely.
+	 *
+	 * @returns number of running easy handles.
+	 * @throws curl::mcode
+	 * @throws std::system_error
+	 */
+	auto run_once(std::chrono::milliseconds timeout = std::chrono::milliseconds(-1))
+		-> int
+	{
+		using clock = std::chrono::steady_clock;
+		auto deadline = clock::now() + timeout;
+		for (;;) {
+			__kernel_timespec ts{};
+			io_uring_getevents_arg arg{};
+			arg.sigmask_sz = _NSIG / 8;
+			if (timeout.count() >= 0) {
+				auto left = std::max(clock::duration::zero(), deadline - clock::now());
+				auto ns   = std::chrono::duration_cast<std::chrono::nanoseconds>(left).count();
+				ts.tv_sec  = ns / 1000000000;
+				ts.tv_nsec = ns % 1000000000;
+				arg.ts     = reinterpret_cast<uintptr_t>(&ts);
+			}
+			auto stop = false;
+			if (enter(1, IORING_ENTER_GETEVENTS, &arg) == -1) {
+				if (errno != ETIME && errno != EINTR) {
+					throw std::system_error(errno, std::generic_category(),
+					                        "io_uring_enter");
+				}
+				stop = true;
+			}
+			// completions of removed or replaced requests are not
+			// activity, so keep waiting if they were all there was.
+			if (reap() || stop) {
+				return _running;
+			}
+		}
+	}
+
+	/**
+	 * Run until there are no running transfers or pending timeouts.
+	 *
+	 * @throws curl::mcode
+	 * @throws std::system_error
+	 */
+	void run()
+	{
+		while (pending()) {
+			run_once();
+		}
+	}
+
+	/**
+	 * Makes a blocked or the next call to run_once return early.
+	 * Safe to call from any thread.
+	 */
+	void wakeup() noexcept
+	{
+		uint64_t one = 1;
+		(void)::write(_wake, &one, sizeof one);
+	}
+
+	/**
+	 * @returns true iff there are running transfers or a pending timeout.
+	 */
+	auto pending() const noexcept -> bool
+	{
+		return _running > 0 || _timer_armed;
+	}
+
+	/**
+	 * @returns number of running easy handles as of the last action.
+	 */
+	auto running() const noexcept -> int
+	{
+		return _running;
+	}
+
+	/**
+	 * Queues poll requests for the socket.
+	 */
+	int on(multi_ref::socket s) noexcept
+	{
+		if (s.sock < 0) {
+			return -1;
+		}
+		auto fd = static_cast<size_t>(s.sock);
+		if (fd >= _socks.size()) {
+			_socks.resize(fd + 1);
+		}
+		auto& state = _socks[fd];
+		unsigned mask = 0;
+		if (s.what != multi_ref::socket::remove) {
+			mask |= (s.what & multi_ref::socket::in)  ? POLLIN  : 0u;
+			mask |= (s.what & multi_ref::socket::out) ? POLLOUT : 0u;
+		}
+		if (state.mask == mask) {
+			return 0;
+		}
+		if (state.mask != 0) {
+			auto sqe = get_sqe();
+			sqe->opcode    = IORING_OP_POLL_REMOVE;
+			sqe->fd        = -1;
+			sqe->addr      = socket_data(s.sock, state.generation);
+			sqe->user_data = ignore_data;
+		}
+		// invalidate completions of the previous poll request.
+		++state.generation;
+		state.mask = mask;
+		if (mask != 0) {
+			arm(s.sock, state);
+		}
+		return 0;
+	}
+
+	/**
+	 * Queues a timeout request replacing any existing one.
+	 */
+	int on(multi_ref::timer t) noexcept
+	{
+		if (_timer_armed) {
+			auto sqe = get_sqe();
+			sqe->opcode    = IORING_OP_TIMEOUT_REMOVE;
+			sqe->fd        = -1;
+			sqe->addr      = timer_data(_timer_generation);
+			sqe->user_data = ignore_data;
+		}
+		++_timer_generation;
+		auto ms = t.timeout.count();
+		_timer_armed = ms >= 0;
+		if (_timer_armed) {
+			// read by the kernel when the request is submitted.
+			_timeout.tv_sec  = ms / 1000;
+			_timeout.tv_nsec = (ms % 1000) * 1000000;
+			auto sqe = get_sqe();
+			sqe->opcode    = IORING_OP_TIMEOUT;
+			sqe->fd        = -1;
+			sqe->addr      = reinterpret_cast<uintptr_t>(&_timeout);
+			sqe->len       = 1;
+			sqe->user_data = timer_data(_timer_generation);
+		}
+		return 0;
+	}
+
+private:
+	struct socket_state {
+		unsigned mask       = 0;
+		uint32_t generation = 0;
+	};
+
+	// user_data layout: timer bit, generation, file descriptor.
+	static constexpr uint64_t ignore_data = ~uint64_t(0);
+	static constexpr uint64_t wake_data   = ~uint64_t(0) - 1;
+	static constexpr uint64_t timer_bit   = uint64_t(1) << 63;
+
+	static auto socket_data(socket_t fd, uint32_t gen) noexcept -> uint64_t
+	{
+		return (uint64_t(gen & 0x7fffffff) << 32) | uint32_t(fd);
+	}
+
+	static auto timer_data(uint64_t gen) noexcept -> uint64_t
+	{
+		return timer_bit | (gen & ~timer_bit);
+	}
+
+	static auto setup(unsigned entries, io_uring_params* p) noexcept -> int
+	{
+		return static_cast<int>(::syscall(__NR_io_uring_setup, entries, p));
+	}
+
+	auto enter(unsigned min_complete, unsigned flags, io_uring_getevents_arg* arg)
+		noexcept -> int
+	{
+		auto to_submit = _sq_tail - _sq_submitted;
+		_sq_submitted = _sq_tail;
+		return static_cast<int>(::syscall(__NR_io_uring_enter, _ring,
+			to_submit, min_complete, flags | IORING_ENTER_EXT_ARG,
+			arg, sizeof *arg));
+	}
+
+	void map_rings(io_uring_params const& p)
+	{
+		_sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+		_cq_size = p.cq_off.cqes  + p.cq_entries * sizeof(io_uring_cqe);
+		if (p.features & IORING_FEAT_SINGLE_MMAP) {
+			_sq_size = _cq_size = std::max(_sq_size, _cq_size);
+		}
+		_sq_ptr = map(_sq_size, IORING_OFF_SQ_RING);
+		_cq_ptr = (p.features & IORING_FEAT_SINGLE_MMAP)
+		        ? _sq_ptr
+		        : map(_cq_size, IORING_OFF_CQ_RING);
+		_sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+		_sqes = static_cast<io_uring_sqe*>(map(_sqes_size, IORING_OFF_SQES));
+
+		auto sq = static_cast<char*>(_sq_ptr);
+		auto cq = static_cast<char*>(_cq_ptr);
+		_sq_head  = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+		_sq_ktail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+		_sq_mask  = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+		_sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+		_sq_entries = p.sq_entries;
+		_cq_head  = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+		_cq_tail  = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+		_cq_mask  = *reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+		_cqes     = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+		_sq_tail = _sq_submitted = *_sq_ktail;
+	}
+
+	auto map(size_t size, off_t offset) -> void*
+	{
+		auto ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+		                  MAP_SHARED | MAP_POPULATE, _ring, offset);
+		if (ptr == MAP_FAILED) {
+			throw std::system_error(errno, std::generic_category(), "mmap");
+		}
+		return ptr;
+	}
+
+	void unmap_rings() noexcept
+	{
+		if (_sqes != nullptr) {
+			::munmap(_sqes, _sqes_size);
+		}
+		if (_cq_ptr != nullptr && _cq_ptr != _sq_ptr) {
+			::munmap(_cq_ptr, _cq_size);
+		}
+		if (_sq_ptr != nullptr) {
+			::munmap(_sq_ptr, _sq_size);
+		}
+	}
+
+	/**
+	 * Returns a cleared submission entry, submitting queued entries first
+	 * if the queue is full.
+	 */
+	auto get_sqe() noexcept -> io_uring_sqe*
+	{
+		while (_sq_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE) >= _sq_entries) {
+			io_uring_getevents_arg arg{};
+			arg.sigmask_sz = _NSIG / 8;
+			enter(0, 0, &arg);
+		}
+		auto index = _sq_tail & _sq_mask;
+		auto sqe = &_sqes[index];
+		std::memset(sqe, 0, sizeof *sqe);
+		_sq_array[index] = index;
+		++_sq_tail;
+		__atomic_store_n(_sq_ktail, _sq_tail, __ATOMIC_RELEASE);
+		return sqe;
+	}
+
+	void arm(socket_t fd, socket_state const& state) noexcept
+	{
+		auto sqe = get_sqe();
+		sqe->opcode        = IORING_OP_POLL_ADD;
+		sqe->fd            = fd;
+		sqe->poll32_events = state.mask;
+		sqe->user_data     = socket_data(fd, state.generation);
+	}
+
+	void arm_wake() noexcept
+	{
+		auto sqe = get_sqe();
+		sqe->opcode        = IORING_OP_POLL_ADD;
+		sqe->fd            = _wake;
+		sqe->poll32_events = POLLIN;
+		sqe->user_data     = wake_data;
+	}
+
+	/**
+	 * Dispatch all available completions.
+	 *
+	 * @returns true iff any of them was a wakeup, timer or socket event.
+	 */
+	auto reap() -> bool
+	{
+		auto active = false;
+		auto head = *_cq_head;
+		while (head != __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE)) {
+			auto cqe = _cqes[head & _cq_mask];
+			__atomic_store_n(_cq_head, ++head, __ATOMIC_RELEASE);
+			if (cqe.user_data == ignore_data) {
+				continue;
+			}
+			if (cqe.user_data == wake_data) {
+				uint64_t count;
+				(void)::read(_wake, &count, sizeof count);
+				arm_wake();
+				active = true;
+				continue;
+			}
+			if (cqe.user_data & timer_bit) {
+				if (cqe.user_data == timer_data(_timer_generation)) {
+					_timer_armed = false;
+					_running = _multi.socket_action(CURL_SOCKET_TIMEOUT, 0);
+					active = true;
+				}
+				continue;
+			}
+			auto fd  = static_cast<socket_t>(cqe.user_data & 0xffffffff);
+			auto gen = static_cast<uint32_t>(cqe.user_data >> 32);
+			auto& state = _socks[static_cast<size_t>(fd)];
+			if (gen != (state.generation & 0x7fffffff) || state.mask == 0) {
+				continue;
+			}
+			if (cqe.res == -ECANCELED) {
+				continue;
+			}
+			auto mask = to_mask(cqe.res);
+			arm(fd, state);
+			_running = _multi.socket_action(fd, mask);
+			active = true;
+		}
+		return active;
+	}
+
+	static auto to_mask(int res) noexcept -> int
+	{
+		if (res < 0) {
+			return CURL_CSELECT_ERR;
+		}
+		int mask = 0;
+		mask |= (res & POLLIN)  ? CURL_CSELECT_IN  : 0;
+		mask |= (res & POLLOUT) ? CURL_CSELECT_OUT : 0;
+		mask |= (res & (POLLERR | POLLHUP)) ? CURL_CSELECT_ERR : 0;
+		return mask;
+	}
+
+	multi_ref                 _multi;
+	int                       _ring = -1;
+	int                       _wake = -1;
+	std::vector<socket_state> _socks;
+	__kernel_timespec         _timeout{};
+	uint64_t                  _timer_generation = 0;
+	int                       _running          = 0;
+	bool                      _timer_armed      = false;
+
+	// ring mappings.
+	void*         _sq_ptr    = nullptr;
+	void*         _cq_ptr    = nullptr;
+	io_uring_sqe* _sqes      = nullptr;
+	size_t        _sq_size   = 0;
+	size_t        _cq_size   = 0;
+	size_t        _sqes_size = 0;
+	unsigned*     _sq_head   = nullptr;
+	unsigned*     _sq_ktail  = nullptr;
+	unsigned*     _sq_array  = nullptr;
+	unsigned      _sq_mask   = 0;
+	unsigned      _sq_entries   = 0;
+	unsigned      _sq_tail      = 0;
+	unsigned      _sq_submitted = 0;
+	unsigned*     _cq_head   = nullptr;
+	unsigned*     _cq_tail   = nullptr;
+	unsigned      _cq_mask   = 0;
+	io_uring_cqe* _cqes      = nullptr;
+};
+
+} // namespace curl
+#endif // CURLPLUSPLUS_URING_LOOP_HPP
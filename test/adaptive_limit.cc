@@ -0,0 +1,97 @@
+/* The limit grows while a host answers at its usual latency, and is cut
+ * when it answers 503 or a transfer fails.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/adaptive_limit.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/scheduler.hpp"
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+struct nowrite {
+	static size_t on(curl::easy::write w) {
+		return w.size();
+	}
+};
+
+int main() try {
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	test::server s([](test::request const& r) {
+		auto res = test::response();
+		if (r.path == "/busy") {
+			res.status = 503;
+		} else {
+			std::this_thread::sleep_for(2ms);
+		}
+		return res;
+	});
+	auto fast = curl::easy();
+	fast.url(s.url("/fast"));
+	fast.set_handler<curl::easy::write, nowrite>();
+	fast.perform();
+	auto busy = curl::easy();
+	busy.url(s.url("/busy"));
+	busy.set_handler<curl::easy::write, nowrite>();
+	busy.perform();
+
+	auto host = curl::host_key::from_url(s.url("/").c_str());
+	auto limit = curl::adaptive_limit();
+	CHECK(limit.limit(host) == 4);
+	for (int i = 0; i < 40; ++i) {
+		limit.update(host, fast, CURLE_OK, limit.limit(host));
+	}
+	auto grown = limit.limit(host);
+	CHECK(grown > 4);
+	// an idle window is not grown.
+	for (int i = 0; i < 40; ++i) {
+		limit.update(host, fast, CURLE_OK, 0);
+	}
+	CHECK(limit.limit(host) == grown);
+	for (int i = 0; i < 40; ++i) {
+		limit.update(host, busy, CURLE_OK, limit.limit(host));
+	}
+	auto cut = limit.limit(host);
+	CHECK(cut < grown);
+	CHECK(cut >= 1);
+	limit.update(host, fast, CURLE_COULDNT_CONNECT, cut);
+	for (int i = 0; i < 40; ++i) {
+		limit.update(host, fast, CURLE_COULDNT_CONNECT, 1);
+	}
+	CHECK(limit.limit(host) == 1);
+	limit.reset(host);
+	CHECK(limit.limit(host) == 4);
+
+	// as the limit of a scheduler.
+	auto m = curl::multi();
+	curl::epoll_loop loop(m);
+	curl::scheduler<curl::adaptive_limit> sched(m);
+	auto handles = std::vector<std::unique_ptr<curl::easy>>();
+	auto ok = 0;
+	for (int i = 0; i < 16; ++i) {
+		handles.emplace_back(new curl::easy);
+		auto& e = *handles.back();
+		e.url(s.url("/fast"));
+		e.set_handler<curl::easy::write, nowrite>();
+		sched.submit(e, host, sched.bulk,
+			[&](curl::easy_ref, curl::code c, curl::scheduler<curl::adaptive_limit>::timings) {
+				ok += !c;
+			});
+	}
+	CHECK(sched.running() == 4);
+	while (sched.queued() + sched.running() > 0) {
+		loop.run_once(100ms);
+		m.dispatch();
+	}
+	CHECK(ok == 16);
+	CHECK(sched.host_limit().limit(host) >= 1);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
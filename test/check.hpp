@@ -0,0 +1,35 @@
+#ifndef CURLPLUSPLUS_TEST_CHECK_HPP
+#define CURLPLUSPLUS_TEST_CHECK_HPP
+#include <atomic>
+#include <cstdio>
+
+namespace test {
+
+inline auto failures() noexcept -> std::atomic<int>&
+{
+	static std::atomic<int> n{0};
+	return n;
+}
+
+inline void fail(const char* what, const char* file, int line) noexcept
+{
+	fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+	++failures();
+}
+
+/**
+ * @returns exit status of a test, non zero if any check failed.
+ */
+inline auto result() noexcept -> int
+{
+	return failures() == 0 ? 0 : 1;
+}
+
+} // namespace test
+
+/**
+ * Report x if false, and keep going so one run shows every failure.
+ */
+#define CHECK(x) ((x) ? (void)0 : test::fail(#x, __FILE__, __LINE__))
+
+#endif // CURLPLUSPLUS_TEST_CHECK_HPP
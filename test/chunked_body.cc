@@ -0,0 +1,59 @@
+/* A chunked response lands in whole slabs, and every view of the body
+ * gives back the bytes that were sent.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/chunked_body.hpp"
+#include "curl++/easy.hpp"
+#include "curl++/global.hpp"
+#include <string>
+
+int main() try {
+	auto g = curl::global();
+	auto data = test::pattern(300000);
+	test::server s([&](test::request const&) {
+		auto res = test::response();
+		res.body    = data;
+		res.chunked = true;
+		return res;
+	});
+
+	auto body = curl::chunked_body();
+	auto e = curl::easy();
+	e.url(s.url("/"));
+	e.set_handler<curl::easy::write>(&body);
+	e.perform();
+	CHECK(body.size() == data.size());
+	CHECK(body.str() == data);
+	auto slabs = (data.size() + body.slab_size - 1) / body.slab_size;
+	CHECK(body.segments() == slabs);
+	for (size_t i = 0; i + 1 < body.segments(); ++i) {
+		CHECK(body.segment(i).size() == body.slab_size);
+	}
+
+	auto joined = std::string();
+	for (curl::const_buffer b : body) {
+		joined.append(b.data(), b.size());
+	}
+	CHECK(joined == data);
+	auto total = size_t(0);
+	for (auto& v : body.iovecs()) {
+		total += v.iov_len;
+	}
+	CHECK(total == data.size());
+	auto copy = std::string(data.size(), '\0');
+	body.copy_to(&copy[0]);
+	CHECK(copy == data);
+
+	body.clear();
+	CHECK(body.empty());
+	CHECK(body.segments() == 0);
+	body.append({ "abc", 3 });
+	body.append({ "def", 3 });
+	CHECK(body.str() == "abcdef");
+	CHECK(body.segments() == 1);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
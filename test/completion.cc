@@ -0,0 +1,106 @@
+/* Completions attached through CURLOPT_PRIVATE are found again by
+ * dispatch(), which removes the handle before invoking them, so a
+ * completion may add its own handle again for another transfer.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/completion.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include <string>
+#include <vector>
+
+struct request : curl::easy_base<request> {
+	auto on(curl::easy::write w) noexcept -> size_t
+	{
+		body.append(w.data(), w.size());
+		return w.size();
+	}
+
+	void on(curl::multi_ref::done d)
+	{
+		CHECK(d.easy.raw() == raw());
+		bodies.push_back(body);
+		results.push_back(d.result);
+		body.clear();
+		if (++round < urls.size()) {
+			// fails if the handle was still part of the multi handle.
+			url(urls[round]);
+			d.multi.add_handle(d.easy);
+		}
+	}
+
+	std::vector<std::string> urls;
+	size_t                   round = 0;
+	std::string              body;
+	std::vector<std::string> bodies;
+	std::vector<curl::code>  results;
+	curl::completion         completion{this};
+};
+
+struct failure {
+	curl::code result = CURLE_OK;
+	int        calls  = 0;
+};
+
+static void failed(void* data, curl::multi_ref::done d)
+{
+	auto& f = *static_cast<failure*>(data);
+	f.result = d.result;
+	++f.calls;
+}
+
+int main() try {
+	auto g = curl::global();
+	test::server s([](test::request const& r) {
+		auto res = test::response();
+		res.body = r.path;
+		return res;
+	});
+
+	auto m = curl::multi();
+	curl::epoll_loop loop(m);
+
+	request a;
+	a.urls = { s.url("/a1"), s.url("/a2"), s.url("/a3") };
+	a.url(a.urls.front());
+	a.completion.attach(a);
+	CHECK(a.userdata<curl::completion*>() == &a.completion);
+	m.add_handle(a);
+
+	request b;
+	b.urls = { s.url("/b1") };
+	b.url(b.urls.front());
+	b.completion.attach(b);
+	m.add_handle(b);
+
+	failure f;
+	curl::completion fc(&failed, &f);
+	auto refused = curl::easy();
+	refused.url("http://127.0.0.1:1/");
+	fc.attach(refused);
+	m.add_handle(refused);
+
+	auto dispatched = size_t(0);
+	while (loop.pending()) {
+		loop.run_once();
+		dispatched += m.dispatch();
+	}
+	CHECK(dispatched == 5);
+	CHECK(a.bodies == (std::vector<std::string>{ "/a1", "/a2", "/a3" }));
+	CHECK(a.results == (std::vector<curl::code>{ CURLE_OK, CURLE_OK, CURLE_OK }));
+	CHECK(b.bodies == (std::vector<std::string>{ "/b1" }));
+	CHECK(f.calls == 1);
+	CHECK(f.result == CURLE_COULDNT_CONNECT);
+	// every handle has been removed, so each can be added once more.
+	for (auto e : { curl::easy_ref(a), curl::easy_ref(b), curl::easy_ref(refused) }) {
+		m.add_handle(e);
+		m.remove_handle(e);
+	}
+	CHECK(m.dispatch() == 0);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
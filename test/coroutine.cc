@@ -0,0 +1,121 @@
+/* Coroutines awaiting transfers against a local server resume with each
+ * result, one after the other or several at once, including a transfer
+ * that fails. Skipped where the compiler has no coroutines.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/coroutine.hpp"
+#include "curl++/global.hpp"
+
+#if defined(__cpp_impl_coroutine)
+#include <chrono>
+#include <coroutine>
+#include <exception>
+#include <string>
+#include <thread>
+#include <vector>
+
+// minimal fire and forget coroutine type.
+struct detached {
+	struct promise_type {
+		auto get_return_object() noexcept -> detached { return {}; }
+		auto initial_suspend() noexcept -> std::suspend_never { return {}; }
+		auto final_suspend() noexcept -> std::suspend_never { return {}; }
+		void return_void() noexcept {}
+		void unhandled_exception() { std::terminate(); }
+	};
+};
+
+struct page : curl::easy_base<page> {
+	auto on(curl::easy::write w) noexcept -> size_t
+	{
+		body.append(w.data(), w.size());
+		return w.size();
+	}
+	std::string body;
+};
+
+struct outcome {
+	std::vector<std::string> bodies;
+	std::vector<curl::code>  results;
+	bool                     finished = false;
+};
+
+// fetch the paths one after the other with the same handle.
+auto fetch_all(curl::client<>& c, test::server& s, std::vector<std::string> paths, outcome& out)
+	-> detached
+{
+	page p;
+	p.setopt(CURLOPT_FAILONERROR, 1L);
+	for (auto& path : paths) {
+		p.body.clear();
+		p.url(s.url(path));
+		auto result = co_await c.fetch(p);
+		out.results.push_back(result);
+		out.bodies.push_back(p.body);
+	}
+	out.finished = true;
+}
+
+auto fetch_url(curl::client<>& c, std::string url, outcome& out) -> detached
+{
+	page p;
+	p.url(url);
+	out.results.push_back(co_await c.fetch(p));
+	out.finished = true;
+}
+
+int main() try {
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	test::server s([](test::request const& r) {
+		auto res = test::response();
+		if (r.path == "/missing") {
+			res.status = 404;
+		} else if (r.path.compare(0, 5, "/slow") == 0) {
+			std::this_thread::sleep_for(200ms);
+		}
+		res.body = r.path;
+		return res;
+	});
+
+	curl::client<> c;
+	outcome one;
+	outcome two;
+	outcome three;
+	fetch_all(c, s, { "/a", "/missing", "/b" }, one);
+	fetch_all(c, s, { "/slow1", "/c" }, two);
+	fetch_all(c, s, { "/slow2" }, three);
+	// all three are waiting on their first transfer.
+	CHECK(!one.finished && !two.finished && !three.finished);
+	auto start = std::chrono::steady_clock::now();
+	c.run();
+	auto elapsed = std::chrono::steady_clock::now() - start;
+
+	CHECK(one.finished && two.finished && three.finished);
+	CHECK(one.results == (std::vector<curl::code>{ CURLE_OK, CURLE_HTTP_RETURNED_ERROR, CURLE_OK }));
+	CHECK(one.bodies == (std::vector<std::string>{ "/a", "", "/b" }));
+	CHECK(two.bodies == (std::vector<std::string>{ "/slow1", "/c" }));
+	CHECK(two.results == (std::vector<curl::code>{ CURLE_OK, CURLE_OK }));
+	CHECK(three.bodies == (std::vector<std::string>{ "/slow2" }));
+	// the slow ones ran side by side.
+	CHECK(elapsed < 390ms);
+
+	// a transfer that can not connect resumes its coroutine with the error.
+	outcome refused;
+	fetch_url(c, "http://127.0.0.1:1/", refused);
+	c.run();
+	CHECK(refused.finished);
+	CHECK(refused.results == (std::vector<curl::code>{ CURLE_COULDNT_CONNECT }));
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
+#else
+int main()
+{
+	fprintf(stderr, "coroutines are not supported, skipping\n");
+	return 77;
+}
+#endif
@@ -0,0 +1,145 @@
+/* Each digest matches its published test vectors however the input is
+ * split, and digest_stage checks a body against the digest headers of
+ * its response.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/digest.hpp"
+#include "curl++/easy.hpp"
+#include "curl++/global.hpp"
+#include <cstdint>
+#include <string>
+
+using stage = curl::digest_stage<curl::crc32c, curl::xxhash64, curl::sha256>;
+
+struct download : curl::easy_base<download> {
+	auto on(header h) noexcept -> size_t { return digests.on(h); }
+	auto on(write w) noexcept -> size_t { return digests.on(w); }
+
+	stage digests;
+};
+
+static auto hex(std::string const& s) -> std::string
+{
+	static const char digits[] = "0123456789abcdef";
+	auto out = std::string();
+	for (unsigned char c : s) {
+		out += digits[c >> 4];
+		out += digits[c & 15];
+	}
+	return out;
+}
+
+static auto base64(std::string const& s) -> std::string
+{
+	static const char alphabet[] =
+		"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	auto out = std::string();
+	for (size_t i = 0; i < s.size(); i += 3) {
+		auto n = std::min<size_t>(3, s.size() - i);
+		uint32_t v = 0;
+		for (size_t k = 0; k < 3; ++k) {
+			v = v << 8 | (k < n ? static_cast<unsigned char>(s[i + k]) : 0);
+		}
+		for (size_t k = 0; k < 4; ++k) {
+			out += k <= n ? alphabet[v >> (18 - 6 * k) & 63] : '=';
+		}
+	}
+	return out;
+}
+
+template<typename D>
+static auto digest_of(std::string const& s, size_t step) -> std::string
+{
+	auto d = D();
+	for (size_t i = 0; i < s.size(); i += step) {
+		d.update({ s.data() + i, std::min(step, s.size() - i) });
+	}
+	return d.digest();
+}
+
+int main() try {
+	auto g = curl::global();
+	auto million = std::string(1000000, 'a');
+	for (size_t step : { 1, 7, 64, 1000, 1000000 }) {
+		CHECK(hex(digest_of<curl::crc32c>("123456789", step)) == "e3069283");
+		CHECK(hex(digest_of<curl::xxhash64>("", step)) == "ef46db3751d8e999");
+		CHECK(hex(digest_of<curl::xxhash64>("abc", step)) == "44bc2cf5ad770999");
+		CHECK(hex(digest_of<curl::sha256>("abc", step))
+		      == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+		CHECK(hex(digest_of<curl::sha256>(million, step))
+		      == "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+	}
+
+	auto data = test::pattern(1000001);
+	auto sha = base64(digest_of<curl::sha256>(data, data.size()));
+	auto crc = base64(digest_of<curl::crc32c>(data, data.size()));
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		res.body    = data;
+		res.chunked = true;
+		if (r.path == "/content-digest") {
+			res.headers.emplace_back("Content-Digest", "md5=:AAAA:, sha-256=:" + sha + ":");
+		} else if (r.path == "/amz") {
+			res.headers.emplace_back("x-amz-checksum-crc32c", crc);
+			res.headers.emplace_back("x-amz-checksum-sha256", sha);
+		} else if (r.path == "/bad") {
+			res.headers.emplace_back("Content-Digest", "sha-256=:" + crc + ":");
+		} else if (r.path == "/moved") {
+			res.status = 302;
+			res.body   = "elsewhere";
+			res.headers.emplace_back("Location", "/none");
+			res.headers.emplace_back("x-amz-checksum-sha256", sha);
+		}
+		return res;
+	});
+	auto fetch = [&](download& d, const char* path) {
+		d.url(s.url(path));
+		d.follow_location(true);
+		try {
+			d.perform();
+			return d.digests.result(CURLE_OK);
+		} catch (curl::code const& c) {
+			return d.digests.result(c);
+		}
+	};
+
+	{
+		auto d = download();
+		CHECK(fetch(d, "/content-digest") == CURLE_OK);
+		CHECK(d.digests.checked());
+		CHECK(d.digests.check<curl::sha256>() == stage::verdict::match);
+		CHECK(d.digests.check<curl::crc32c>() == stage::verdict::unchecked);
+	}
+	{
+		auto d = download();
+		CHECK(fetch(d, "/amz") == CURLE_OK);
+		CHECK(d.digests.check<curl::crc32c>() == stage::verdict::match);
+		CHECK(d.digests.check<curl::sha256>() == stage::verdict::match);
+	}
+	{
+		auto d = download();
+		CHECK(fetch(d, "/bad") == CURLE_BAD_CONTENT_ENCODING);
+		CHECK(!d.digests.ok());
+	}
+	{
+		// the digest of the redirect does not carry over.
+		auto d = download();
+		CHECK(fetch(d, "/moved") == CURLE_OK);
+		CHECK(!d.digests.checked());
+		CHECK(d.digests.get<curl::sha256>().digest() == digest_of<curl::sha256>(data, 4096));
+	}
+	{
+		// a pinned value holds over the response and across bodies.
+		auto d = download();
+		d.digests.expect<curl::xxhash64>(digest_of<curl::xxhash64>(data, 333));
+		CHECK(fetch(d, "/none") == CURLE_OK);
+		CHECK(d.digests.check<curl::xxhash64>() == stage::verdict::match);
+		d.digests.expect<curl::xxhash64>(std::string(8, '\0'));
+		CHECK(fetch(d, "/none") == CURLE_BAD_CONTENT_ENCODING);
+	}
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,116 @@
+/* A recycled handle keeps its connection, its handlers and the options it
+ * was constructed with, while the options a lease changed go back to
+ * their defaults. Options without a known default reset the handle
+ * completely, and types derived from easy_base get their handlers back.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/easy_pool.hpp"
+#include "curl++/global.hpp"
+#include <string>
+
+struct counter : curl::easy_base<counter> {
+	counter()
+	{
+		setopt(CURLOPT_USERAGENT, "pooled");
+	}
+
+	auto on(curl::easy::write w) noexcept -> size_t
+	{
+		body.append(w.data(), w.size());
+		return w.size();
+	}
+
+	// called by the pool only when it reset the handle.
+	void set_handlers() noexcept
+	{
+		++rewires;
+		easy_base::set_handlers();
+	}
+
+	std::string body;
+	int         rewires = 0;
+};
+
+int main() try {
+	auto g = curl::global();
+	test::server s([](test::request const& r) {
+		auto res = test::response();
+		res.body = r.method + " " + r.path + " " + r.header("user-agent");
+		return res;
+	}, true);
+
+	curl::easy_pool<counter> pool;
+	counter* first = nullptr;
+	{
+		auto e = pool.acquire();
+		first = e.get();
+		e.setopt(CURLOPT_URL, s.url("/one").c_str());
+		e.setopt(CURLOPT_POST, 1L);
+		e.setopt(CURLOPT_POSTFIELDS, "x");
+		e->perform();
+		CHECK(e->body == "POST /one pooled");
+		CHECK(e->num_connects() == 1);
+	}
+	CHECK(pool.idle() == 1);
+	CHECK(pool.idle_bytes() == pool.default_handle_bytes);
+	{
+		auto e = pool.acquire();
+		CHECK(e.get() == first);
+		CHECK(pool.idle() == 0);
+		// only what the lease set was undone.
+		CHECK(e->rewires == 0);
+		auto failed = false;
+		try {
+			e->perform();
+		} catch (curl::code const&) {
+			failed = true;
+		}
+		CHECK(failed);
+		e->body.clear();
+		e->url(s.url("/two"));
+		e.touch(CURLOPT_URL);
+		e->perform();
+		CHECK(e->body == "GET /two pooled");
+		// over the connection of the previous lease.
+		CHECK(e->num_connects() == 0);
+	}
+	{
+		auto e = pool.acquire();
+		CHECK(e->rewires == 0);
+		e.setopt(CURLOPT_CAINFO, "/nonexistent");
+	}
+	{
+		// a CA path has a built-in default, so the handle was reset.
+		auto e = pool.acquire();
+		CHECK(e->rewires == 1);
+		e->body.clear();
+		e.setopt(CURLOPT_URL, s.url("/three").c_str());
+		e->perform();
+		CHECK(e->body == "GET /three ");
+		e.touch_all();
+	}
+	{
+		auto e = pool.acquire();
+		CHECK(e->rewires == 2);
+	}
+	{
+		auto a = pool.acquire();
+		auto b = pool.acquire();
+		CHECK(a.get() != b.get());
+		auto c = std::move(b);
+		CHECK(!b);
+		CHECK(c);
+	}
+	CHECK(pool.idle() == 2);
+	pool.shrink(0);
+	CHECK(pool.idle() == 0);
+	{
+		auto e = pool.acquire();
+	}
+	CHECK(pool.idle() == 0);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,101 @@
+/* The epoll loop on its own: concurrent downloads and an upload all finish
+ * through run(), which leaves nothing pending, and wakeup() returns a
+ * blocked run_once() early.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct fetch : curl::easy_base<fetch> {
+	auto on(curl::easy::write w) noexcept -> size_t
+	{
+		body.append(w.data(), w.size());
+		return w.size();
+	}
+	std::string body;
+};
+
+int main() try {
+	using namespace std::chrono;
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	auto data = test::pattern(1 << 20);
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		if (r.method == "POST") {
+			res.body = std::to_string(r.body.size()) + (r.body == data ? " same" : " different");
+			return res;
+		}
+		std::this_thread::sleep_for(300ms);
+		res.body = r.path;
+		return res;
+	});
+
+	auto m = curl::multi();
+	curl::epoll_loop loop(m);
+	CHECK(!loop.pending());
+
+	std::vector<std::unique_ptr<fetch>> fetches;
+	for (int i = 0; i < 10; ++i) {
+		fetches.emplace_back(new fetch);
+		fetches.back()->url(s.url("/" + std::to_string(i)));
+		m.add_handle(*fetches.back());
+	}
+	// the upload reads its body in pieces, which only finishes if a
+	// writable socket keeps being reported.
+	fetches.emplace_back(new fetch);
+	auto& upload = *fetches.back();
+	upload.url(s.url("/upload"));
+	upload.setopt(CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(data.size()));
+	upload.setopt(CURLOPT_POSTFIELDS, data.data());
+	m.add_handle(upload);
+
+	auto start = steady_clock::now();
+	loop.run();
+	auto elapsed = steady_clock::now() - start;
+	// one after the other would take three seconds.
+	CHECK(elapsed < 2s);
+	CHECK(!loop.pending());
+	CHECK(loop.running() == 0);
+	auto done = 0;
+	for (auto msg : m.info_read()) {
+		if (msg->msg == CURLMSG_DONE) {
+			CHECK(msg->result == CURLE_OK);
+			m.remove_handle(msg->ref);
+			++done;
+		}
+	}
+	CHECK(done == 11);
+	for (int i = 0; i < 10; ++i) {
+		CHECK(fetches[i]->body == "/" + std::to_string(i));
+	}
+	CHECK(upload.body == std::to_string(data.size()) + " same");
+
+	// nothing to do, so only the wakeup ends the wait.
+	auto waker = std::thread([&] {
+		std::this_thread::sleep_for(100ms);
+		loop.wakeup();
+	});
+	start = steady_clock::now();
+	loop.run_once(10s);
+	elapsed = steady_clock::now() - start;
+	waker.join();
+	CHECK(elapsed >= 50ms);
+	CHECK(elapsed < 5s);
+	// a wakeup before the wait is not lost.
+	loop.wakeup();
+	start = steady_clock::now();
+	loop.run_once(10s);
+	CHECK(steady_clock::now() - start < 5s);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
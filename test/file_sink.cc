@@ -0,0 +1,114 @@
+/* Both file sinks leave exactly the body in the file, with or without a
+ * known length, and a pwrite_sink writes at its offset of a shared file.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/easy.hpp"
+#include "curl++/file_sink.hpp"
+#include "curl++/global.hpp"
+#include <fcntl.h>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <unistd.h>
+
+struct download : curl::easy_base<download> {
+	explicit download(const char* path)
+	: file(path)
+	{}
+
+	auto on(header h) noexcept -> size_t { return file.on(h); }
+	auto on(write w) noexcept -> size_t { return file.on(w); }
+
+	curl::mmap_sink file;
+};
+
+static auto slurp(const char* path) -> std::string
+{
+	auto f = std::ifstream(path, std::ios::binary);
+	return { std::istreambuf_iterator<char>(f), {} };
+}
+
+int main() try {
+	auto g = curl::global();
+	auto data = test::pattern(300001);
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		if (r.path.find("/half/") == 0) {
+			auto half = data.size() / 2;
+			res.body = r.path == "/half/0" ? data.substr(0, half) : data.substr(half);
+		} else {
+			res.body = data;
+		}
+		res.chunked = r.path == "/chunked";
+		return res;
+	});
+
+	for (auto path : { "/sized", "/chunked" }) {
+		{
+			download d("file_sink.mmap");
+			d.url(s.url(path));
+			d.perform();
+			d.file.finish();
+			CHECK(d.file.written() == data.size());
+			CHECK(d.file.error() == 0);
+		}
+		CHECK(slurp("file_sink.mmap") == data);
+	}
+
+	auto small = curl::pwrite_sink::options();
+	small.coalesce  = 8192;
+	small.block     = 4096;
+	small.alignment = 512;
+	auto direct = curl::pwrite_sink::options();
+	direct.direct = true;
+	for (auto o : { curl::pwrite_sink::options(), small, direct }) {
+		{
+			curl::pwrite_sink sink("file_sink.pwrite", o);
+			auto e = curl::easy();
+			e.url(s.url("/chunked"));
+			e.set_handler<curl::easy::write>(&sink);
+			e.perform();
+			sink.finish();
+			CHECK(sink.written() == data.size());
+			CHECK(sink.error() == 0);
+		}
+		CHECK(slurp("file_sink.pwrite") == data);
+	}
+
+	// two halves written through one descriptor.
+	{
+		auto fd = ::open("file_sink.shared", O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+		CHECK(fd >= 0);
+		for (int i = 0; i < 2; ++i) {
+			auto offset = static_cast<off_t>(i * (data.size() / 2));
+			curl::pwrite_sink sink(fd, offset, small);
+			auto e = curl::easy();
+			e.url(s.url("/half/" + std::to_string(i)));
+			e.set_handler<curl::easy::write>(&sink);
+			e.perform();
+			sink.finish();
+		}
+		::close(fd);
+		CHECK(slurp("file_sink.shared") == data);
+	}
+
+	for (auto alignment : { size_t(0), size_t(3000) }) {
+		auto o = curl::pwrite_sink::options();
+		o.alignment = alignment;
+		auto code = 0;
+		try {
+			curl::pwrite_sink("file_sink.pwrite", o);
+		} catch (std::system_error const& e) {
+			code = e.code().value();
+		}
+		CHECK(code == EINVAL);
+	}
+	::unlink("file_sink.mmap");
+	::unlink("file_sink.pwrite");
+	::unlink("file_sink.shared");
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
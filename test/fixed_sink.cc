@@ -0,0 +1,60 @@
+/* A body that fits lands in the caller's buffer, and one that does not
+ * fails with CURLE_FILESIZE_EXCEEDED whether or not its length was known.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/easy.hpp"
+#include "curl++/fixed_sink.hpp"
+#include "curl++/global.hpp"
+#include <string>
+#include <vector>
+
+int main() try {
+	auto g = curl::global();
+	auto data = test::pattern(200000);
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		auto n = std::stoul(r.path.substr(r.path.rfind('/') + 1));
+		res.body    = data.substr(0, n);
+		res.chunked = r.path.find("/chunked/") == 0;
+		return res;
+	});
+	auto fetch = [&](curl::fixed_sink& sink, std::string const& path) {
+		auto e = curl::easy();
+		e.url(s.url(path));
+		sink.attach(e);
+		try {
+			e.perform();
+			return curl::code(CURLE_OK);
+		} catch (curl::code const& c) {
+			return sink.result(c);
+		}
+	};
+
+	auto slot = std::vector<char>(100000);
+	curl::fixed_sink sink({ slot.data(), slot.size() });
+	CHECK(fetch(sink, "/50000") == CURLE_OK);
+	CHECK(sink.filled() == 50000);
+	CHECK(std::string(sink.data().data(), sink.data().size()) == data.substr(0, 50000));
+	CHECK(!sink.overflowed());
+
+	// refused from Content-Length, before the body arrives.
+	sink.reset({ slot.data(), slot.size() });
+	CHECK(fetch(sink, "/150000") == CURLE_FILESIZE_EXCEEDED);
+	CHECK(sink.filled() == 0);
+
+	// no length, so the overflow is only seen by the sink.
+	sink.reset({ slot.data(), slot.size() });
+	CHECK(fetch(sink, "/chunked/150000") == CURLE_FILESIZE_EXCEEDED);
+	CHECK(sink.overflowed());
+	CHECK(sink.filled() <= slot.size());
+
+	sink.reset({ slot.data(), slot.size() });
+	CHECK(fetch(sink, "/chunked/100000") == CURLE_OK);
+	CHECK(sink.filled() == 100000);
+	CHECK(std::string(slot.begin(), slot.end()) == data.substr(0, 100000));
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
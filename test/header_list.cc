@@ -0,0 +1,79 @@
+/* Headers of the list and of its shared base reach the server, and a
+ * list rebuilt for every request stops growing once warmed up.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/easy.hpp"
+#include "curl++/global.hpp"
+#include "curl++/header_list.hpp"
+#include <memory>
+#include <mutex>
+#include <string>
+
+struct nowrite {
+	static size_t on(curl::easy::write w) {
+		return w.size();
+	}
+};
+
+int main() try {
+	auto g = curl::global();
+	std::mutex mutex;
+	auto last = test::request();
+	test::server s([&](test::request const& r) {
+		std::lock_guard<std::mutex> lock(mutex);
+		last = r;
+		return test::response();
+	});
+
+	auto common = std::make_shared<curl::header_list>();
+	common->append("Authorization", "Bearer token");
+	common->append("User-Agent: list/1.0");
+	CHECK(common->size() == 2);
+
+	auto headers = curl::header_list(64);
+	headers.base(common);
+	CHECK(headers.empty());
+	CHECK(headers.get() == common->get());
+
+	auto e = curl::easy();
+	e.set_handler<curl::easy::write, nowrite>();
+	auto warm = size_t(0);
+	for (int i = 0; i < 20; ++i) {
+		headers.clear();
+		headers.append("X-Request", std::to_string(i).c_str());
+		headers.append("X-Padding", std::string(static_cast<size_t>(i % 5) * 30, 'p').c_str());
+		headers.remove("Accept");
+		CHECK(headers.size() == 3);
+		headers.attach(e);
+		e.url(s.url("/"));
+		e.perform();
+		CHECK(last.header("x-request") == std::to_string(i));
+		CHECK(last.header("authorization") == "Bearer token");
+		CHECK(last.header("user-agent") == "list/1.0");
+		CHECK(last.headers.count("accept") == 0);
+		// an empty value is still sent.
+		CHECK(last.headers.count("x-padding") == 1);
+		if (i == 5) {
+			warm = headers.capacity();
+		}
+	}
+	CHECK(headers.capacity() == warm);
+
+	auto n = 0;
+	for (auto p = headers.get(); p != nullptr; p = p->next) {
+		++n;
+	}
+	CHECK(n == 5);
+
+	auto moved = std::move(headers);
+	CHECK(moved.size() == 3);
+	CHECK(moved.base() == common);
+	moved.base(nullptr);
+	moved.clear();
+	CHECK(moved.get() == nullptr);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
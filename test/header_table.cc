@@ -0,0 +1,102 @@
+/* Headers are looked up ignoring case, folded and repeated headers are
+ * kept, and after a redirect only the final response is left.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/easy.hpp"
+#include "curl++/global.hpp"
+#include "curl++/header_table.hpp"
+#include <string>
+
+struct request : curl::easy_base<request> {
+	auto on(header h) noexcept -> size_t { return headers.on(h); }
+
+	curl::header_table headers;
+};
+
+static auto str(curl::const_buffer b) -> std::string
+{
+	return { b.data(), b.size() };
+}
+
+static void add(curl::header_table& t, std::string const& line)
+{
+	t.add({ line.data(), line.size() });
+}
+
+int main() try {
+	auto g = curl::global();
+	{
+		auto t = curl::header_table(16);
+		add(t, "HTTP/1.1 200 OK\r\n");
+		add(t, "Content-Type:  text/plain \r\n");
+		add(t, "Set-Cookie: a=1\r\n");
+		add(t, "X-Folded: first\r\n");
+		add(t, "\t second\r\n");
+		add(t, "SET-COOKIE: b=2\r\n");
+		add(t, "Content-Length: 42\r\n");
+		add(t, "X-Empty:\r\n");
+		CHECK(!t.complete());
+		add(t, "\r\n");
+		CHECK(t.complete());
+		CHECK(t.status() == 200);
+		CHECK(t.version() == 11);
+		CHECK(str(t.reason()) == "OK");
+		CHECK(t.size() == 6);
+		CHECK(str(t.get("content-type")) == "text/plain");
+		CHECK(str(t.get("CONTENT-TYPE")) == "text/plain");
+		CHECK(str(t.get("x-folded")) == "first second");
+		CHECK(t.has("x-empty"));
+		CHECK(t.get("x-empty").empty());
+		CHECK(!t.has("x-missing"));
+		CHECK(t.content_length() == 42);
+		auto first = t.find("set-cookie");
+		auto second = t.find("set-cookie", first + 1);
+		CHECK(str(t[first].value) == "a=1");
+		CHECK(str(t[second].value) == "b=2");
+		CHECK(str(t[second].name) == "set-cookie");
+		CHECK(t.find("set-cookie", second + 1) == t.size());
+		// names and values longer than 16 bytes, past the reservation.
+		auto name = std::string(40, 'N');
+		add(t, name + ": " + std::string(100, 'v') + "\r\n");
+		CHECK(str(t.get(std::string(40, 'n').c_str())) == std::string(100, 'v'));
+		add(t, "HTTP/2 404\r\n");
+		CHECK(t.status() == 404);
+		CHECK(t.version() == 20);
+		CHECK(t.reason().empty());
+		CHECK(t.empty());
+		CHECK(t.content_length() == curl::detail::unknown_length);
+		CHECK(t.responses() == 2);
+		t.reset();
+		CHECK(t.status() == 0);
+		CHECK(t.responses() == 0);
+	}
+
+	test::server s([](test::request const& r) {
+		auto res = test::response();
+		if (r.path == "/moved") {
+			res.status = 302;
+			res.headers.emplace_back("Location", "/final");
+			res.headers.emplace_back("X-Redirect", "yes");
+		} else {
+			res.headers.emplace_back("X-Final", "yes");
+			res.body = "hello";
+		}
+		return res;
+	});
+	auto e = request();
+	e.url(s.url("/moved"));
+	e.follow_location(true);
+	e.perform();
+	CHECK(e.headers.complete());
+	CHECK(e.headers.responses() == 2);
+	CHECK(e.headers.status() == 200);
+	CHECK(e.headers.version() == 11);
+	CHECK(str(e.headers.get("x-final")) == "yes");
+	CHECK(!e.headers.has("x-redirect"));
+	CHECK(e.headers.content_length() == 5);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
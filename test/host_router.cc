@@ -0,0 +1,133 @@
+/* Host keys only depend on the origin of a url, rendezvous routing keeps a
+ * host on its shard and only moves the hosts of a shard that drops out,
+ * and requests routed by host reuse their shard's connections, as
+ * num_connects shows.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/global.hpp"
+#include "curl++/host_router.hpp"
+#include "curl++/multi_pool.hpp"
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct nowrite {
+	static auto on(curl::easy::write w) noexcept -> size_t
+	{
+		return w.size();
+	}
+};
+
+auto key(std::string const& url) -> curl::host_key
+{
+	return curl::host_key::from_url(url.c_str());
+}
+
+auto host(size_t i) -> std::string
+{
+	return "https://host" + std::to_string(i) + ".example:8443";
+}
+
+int main() try {
+	// only scheme, host and port count.
+	CHECK(key("http://a.example/x") == key("http://a.example/y?q#f"));
+	CHECK(key("http://a.example/x") == key("HTTP://A.Example/x"));
+	CHECK(key("http://a.example/x") == key("http://user:pw@a.example/x"));
+	CHECK(!(key("http://a.example/") == key("https://a.example/")));
+	CHECK(!(key("http://a.example/") == key("http://a.example:8080/")));
+	CHECK(!(key("http://a.example/") == key("http://b.example/")));
+
+	// the same host lands on the same shard, from any router of that size.
+	auto const shards = size_t(8);
+	auto const hosts  = size_t(2000);
+	auto router = curl::host_router(shards, shards);
+	std::vector<size_t> home(hosts);
+	std::vector<size_t> load(shards);
+	for (size_t i = 0; i < hosts; ++i) {
+		home[i] = router.route(key(host(i)));
+		++load[home[i]];
+		CHECK(curl::host_router(shards).route(key(host(i))) == home[i]);
+		CHECK(router.route(key(host(i) + "/other/path")) == home[i]);
+	}
+	for (auto n : load) {
+		CHECK(n > hosts / shards / 2);
+		CHECK(n < hosts / shards * 2);
+	}
+
+	// a shard that drops out only moves its own hosts, spread over the
+	// others.
+	for (size_t gone = 0; gone < shards; ++gone) {
+		std::vector<size_t> moved(shards);
+		for (size_t i = 0; i < hosts; ++i) {
+			auto to = router.route(key(host(i)), [&](size_t s) { return s == gone; });
+			CHECK(to != gone);
+			if (home[i] != gone) {
+				CHECK(to == home[i]);
+			} else {
+				++moved[to];
+			}
+		}
+		for (size_t s = 0; s < shards; ++s) {
+			CHECK(s == gone || moved[s] > 0);
+		}
+	}
+
+	// a saturated shard overflows to the next in the ranking only, and
+	// with everything saturated the host stays home.
+	auto narrow = curl::host_router(shards, 1);
+	for (size_t i = 0; i < 100; ++i) {
+		auto k = key(host(i));
+		auto second = router.route(k, [&](size_t s) { return s == home[i]; });
+		CHECK(narrow.route(k, [&](size_t s) { return s == home[i]; }) == second);
+		CHECK(narrow.route(k, [&](size_t s) { return s == home[i] || s == second; }) == home[i]);
+		CHECK(narrow.route(k, [](size_t) { return true; }) == home[i]);
+	}
+
+	// one handle used twice connects once.
+	auto g = curl::global();
+	test::server s([](test::request const&) { return test::response(); }, true);
+	{
+		auto e = curl::easy();
+		e.url(s.url("/"));
+		e.set_handler<curl::easy::write, nowrite>();
+		e.perform();
+		CHECK(e.num_connects() == 1);
+		e.perform();
+		CHECK(e.num_connects() == 0);
+	}
+
+	// requests routed by host reuse the connections of their shard, while
+	// the other shards never see them.
+	auto before = s.connections();
+	{
+		curl::multi_pool<> pool(4, 1, 0);
+		std::mutex mutex;
+		std::condition_variable cv;
+		auto connects = long(0);
+		auto done = size_t(0);
+		std::vector<curl::easy> handles(20);
+		auto k = key(s.url("/"));
+		for (size_t i = 0; i < handles.size(); ++i) {
+			handles[i].url(s.url("/" + std::to_string(i)));
+			handles[i].set_handler<curl::easy::write, nowrite>();
+			pool.submit(k, handles[i], [&](curl::easy_ref e, curl::code c) {
+				CHECK(!c);
+				std::lock_guard<std::mutex> lock(mutex);
+				connects += e.num_connects();
+				++done;
+				cv.notify_all();
+			});
+		}
+		std::unique_lock<std::mutex> lock(mutex);
+		CHECK(cv.wait_for(lock, std::chrono::seconds(20), [&] { return done == handles.size(); }));
+		CHECK(connects == 1);
+	}
+	CHECK(s.connections() - before == 1);
+	CHECK(s.requests() == 22);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,139 @@
+/* Lines come out whole however the body is split into write events, and
+ * a transfer stops when the handler says so or a line is too long.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/easy.hpp"
+#include "curl++/global.hpp"
+#include "curl++/line_splitter.hpp"
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+struct feed : curl::easy_base<feed> {
+	feed(std::function<bool(curl::const_buffer)> f, size_t max_line = 1024 * 1024)
+	: lines(std::move(f), max_line)
+	{}
+
+	auto on(write w) noexcept -> size_t { return lines.on(w); }
+
+	curl::line_splitter<std::function<bool(curl::const_buffer)>> lines;
+};
+
+int main() try {
+	auto g = curl::global();
+	auto rng = std::mt19937(1);
+
+	// every offset found, wherever it falls in a block of 64.
+	for (int iter = 0; iter < 200; ++iter) {
+		auto text = std::string(rng() % 300, 'x');
+		for (auto& c : text) {
+			c = rng() % 8 == 0 ? '\n' : 'x';
+		}
+		auto want = std::vector<size_t>();
+		for (size_t i = 0; i < text.size(); ++i) {
+			if (text[i] == '\n') {
+				want.push_back(i);
+			}
+		}
+		auto got = std::vector<size_t>();
+		curl::detail::for_each_byte(text.data(), text.size(), '\n', [&](size_t i) {
+			got.push_back(i);
+			return true;
+		});
+		CHECK(got == want);
+	}
+
+	for (int iter = 0; iter < 500; ++iter) {
+		auto body = std::string();
+		auto want = std::vector<std::string>();
+		for (int i = 0, n = rng() % 50; i < n; ++i) {
+			auto line = std::string(rng() % 200, static_cast<char>('a' + i % 26));
+			if (!line.empty()) {
+				want.push_back(line);
+			}
+			body += line + (rng() % 3 == 0 ? "\r\n" : "\n");
+			if (rng() % 5 == 0) {
+				body += "\n";
+			}
+		}
+		if (rng() % 2) {
+			want.push_back("tail");
+			body += "tail";
+		}
+		auto got = std::vector<std::string>();
+		auto s = curl::make_line_splitter([&](curl::const_buffer b) {
+			got.emplace_back(b.data(), b.size());
+			return true;
+		});
+		for (size_t i = 0; i < body.size(); ) {
+			auto n = std::min<size_t>(body.size() - i, rng() % 300 + 1);
+			auto w = curl::easy_ref::write(&body[i], n, 1, nullptr);
+			CHECK(s.on(w) == n);
+			i += n;
+		}
+		s.finish();
+		CHECK(got == want);
+	}
+
+	auto records = std::string();
+	for (int i = 0; i < 20000; ++i) {
+		records += "{\"id\":" + std::to_string(i) + "}\n";
+	}
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		res.body    = r.path == "/long" ? std::string(100000, 'x') + "\n" : records;
+		res.chunked = true;
+		return res;
+	});
+	{
+		auto count = 0;
+		auto ordered = true;
+		auto f = feed([&](curl::const_buffer b) {
+			ordered = ordered && std::string(b.data(), b.size())
+			                  == "{\"id\":" + std::to_string(count) + "}";
+			++count;
+			return true;
+		});
+		f.url(s.url("/records"));
+		f.perform();
+		CHECK(f.lines.finish());
+		CHECK(count == 20000);
+		CHECK(ordered);
+		CHECK(f.lines.pending() == 0);
+	}
+	{
+		// the handler stops the transfer.
+		auto count = 0;
+		auto f = feed([&](curl::const_buffer) { return ++count < 100; });
+		f.url(s.url("/records"));
+		auto result = curl::code(CURLE_OK);
+		try {
+			f.perform();
+		} catch (curl::code const& c) {
+			result = c;
+		}
+		CHECK(result == CURLE_WRITE_ERROR);
+		CHECK(count == 100);
+	}
+	{
+		auto f = feed([](curl::const_buffer) { return true; }, 4096);
+		f.url(s.url("/long"));
+		auto result = curl::code(CURLE_OK);
+		try {
+			f.perform();
+		} catch (curl::code const& c) {
+			result = c;
+		}
+		CHECK(result == CURLE_WRITE_ERROR);
+		CHECK(f.lines.overflowed());
+		f.lines.reset();
+		CHECK(!f.lines.overflowed());
+		CHECK(f.lines.pending() == 0);
+	}
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,280 @@
+/* Everything submitted to a sharded pool completes when one shard gets all
+ * of it, idle shards steal part of it, requests pinned to a host never
+ * leave its shard, the stats add up to what was submitted, and a shard
+ * whose loop fails hands its work back and is skipped from then on.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi_pool.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Epoll loop that throws from run_once once its index is chosen to fail.
+ */
+struct failing_loop : curl::epoll_loop {
+	explicit failing_loop(curl::multi_ref m)
+	: epoll_loop(m)
+	, index(created()++)
+	{}
+
+	auto run_once() -> int
+	{
+		if (failing() == index) {
+			throw std::runtime_error("loop failed");
+		}
+		return epoll_loop::run_once();
+	}
+
+	static auto created() -> std::atomic<int>&
+	{
+		static std::atomic<int> n{0};
+		return n;
+	}
+
+	static auto failing() -> std::atomic<int>&
+	{
+		static std::atomic<int> n{-1};
+		return n;
+	}
+
+	int index;
+};
+
+struct nowrite {
+	static auto on(curl::easy::write w) noexcept -> size_t
+	{
+		return w.size();
+	}
+};
+
+/**
+ * Outcome of the requests of one part of the test.
+ */
+struct results {
+	std::mutex                  mutex;
+	std::condition_variable     cv;
+	std::vector<curl::code>     codes;
+	std::set<std::thread::id>   threads;
+
+	auto callback() -> std::function<void(curl::easy_ref, curl::code)>
+	{
+		return [this](curl::easy_ref, curl::code c) {
+			std::lock_guard<std::mutex> lock(mutex);
+			codes.push_back(c);
+			threads.insert(std::this_thread::get_id());
+			cv.notify_all();
+		};
+	}
+
+	auto wait(size_t n) -> bool
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		return cv.wait_for(lock, std::chrono::seconds(20), [&] { return codes.size() >= n; });
+	}
+
+	auto all_ok() -> bool
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (auto c : codes) {
+			if (c) {
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+/**
+ * @returns true once check holds, polling for up to five seconds.
+ */
+template<typename F>
+auto eventually(F check) -> bool
+{
+	auto until = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+	while (!check()) {
+		if (std::chrono::steady_clock::now() > until) {
+			return false;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+	return true;
+}
+
+template<typename Pool>
+auto total(Pool const& pool) -> curl::multi_pool<>::shard_stats
+{
+	auto sum = curl::multi_pool<>::shard_stats{ 0, 0 };
+	for (size_t i = 0; i < pool.size(); ++i) {
+		auto s = pool.stats(i);
+		sum.queued  += s.queued;
+		sum.running += s.running;
+	}
+	return sum;
+}
+
+int main() try {
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	std::mutex gate_mutex;
+	std::condition_variable gate_cv;
+	auto gate_open = false;
+	test::server s([&](test::request const& r) {
+		if (r.path == "/gate") {
+			std::unique_lock<std::mutex> lock(gate_mutex);
+			gate_cv.wait(lock, [&] { return gate_open; });
+		} else if (r.path == "/slow") {
+			std::this_thread::sleep_for(50ms);
+		}
+		auto res = test::response();
+		res.body = r.path;
+		return res;
+	});
+	auto gate = [&](bool open) {
+		std::lock_guard<std::mutex> lock(gate_mutex);
+		gate_open = open;
+		gate_cv.notify_all();
+	};
+	auto prepare = [&](curl::easy& e, const char* path) {
+		e.url(s.url(path));
+		e.set_handler<curl::easy::write, nowrite>();
+	};
+
+	// all of it on one shard, which would take a second on its own.
+	{
+		curl::multi_pool<> pool(4, 2);
+		std::vector<curl::easy> handles(40);
+		results r;
+		auto start = std::chrono::steady_clock::now();
+		for (auto& e : handles) {
+			prepare(e, "/slow");
+			pool.submit(0, e, r.callback());
+		}
+		CHECK(r.wait(handles.size()));
+		CHECK(r.all_ok());
+		CHECK(r.threads.size() > 1);
+		CHECK(std::chrono::steady_clock::now() - start < 900ms);
+		CHECK(eventually([&] { return total(pool).queued + total(pool).running == 0; }));
+	}
+
+	// while nothing finishes, the stats account for every request.
+	{
+		gate(false);
+		curl::multi_pool<> pool(4, 2);
+		std::vector<curl::easy> handles(20);
+		results r;
+		for (auto& e : handles) {
+			prepare(e, "/gate");
+			pool.submit(0, e, r.callback());
+		}
+		CHECK(eventually([&] {
+			auto t = total(pool);
+			return t.queued + t.running == handles.size() && t.running >= 4;
+		}));
+		for (size_t i = 0; i < pool.size(); ++i) {
+			CHECK(pool.stats(i).running <= 2);
+		}
+		gate(true);
+		CHECK(r.wait(handles.size()));
+		CHECK(r.all_ok());
+		CHECK(eventually([&] { return total(pool).queued + total(pool).running == 0; }));
+	}
+
+	// pinned requests wait for their own shard while the others are idle.
+	{
+		gate(false);
+		curl::multi_pool<> pool(4, 2, 0);
+		auto host  = curl::host_key::from_url(s.url("/").c_str());
+		auto index = pool.route(host);
+		std::vector<curl::easy> handles(12);
+		results r;
+		for (auto& e : handles) {
+			prepare(e, "/gate");
+			pool.submit(host, e, r.callback());
+		}
+		// unpinned work through every shard gives idle ones a chance
+		// to steal.
+		std::vector<curl::easy> others(8);
+		results o;
+		for (size_t i = 0; i < others.size(); ++i) {
+			prepare(others[i], "/quick");
+			pool.submit(i % pool.size(), others[i], o.callback());
+		}
+		CHECK(o.wait(others.size()));
+		CHECK(o.all_ok());
+		CHECK(eventually([&] {
+			auto st = pool.stats(index);
+			return st.running == 2 && st.queued == handles.size() - 2;
+		}));
+		// the others finish their own work, and take none of it.
+		CHECK(eventually([&] {
+			auto t = total(pool);
+			return t.queued + t.running == handles.size();
+		}));
+		gate(true);
+		CHECK(r.wait(handles.size()));
+		CHECK(r.all_ok());
+		CHECK(r.threads.size() == 1);
+	}
+
+	// a failed shard aborts what it holds and is skipped afterwards.
+	{
+		gate(false);
+		failing_loop::created() = 0;
+		curl::multi_pool<failing_loop> pool(4, 2);
+		// pinned, so no other shard takes it first.
+		auto pin = curl::host_key();
+		for (int i = 0; pool.route(pin) != 1; ++i) {
+			pin = curl::host_key::from_url(("http://host" + std::to_string(i)).c_str());
+		}
+		curl::easy held;
+		prepare(held, "/gate");
+		results r;
+		pool.submit(pin, held, r.callback());
+		CHECK(eventually([&] { return pool.stats(1).running == 1; }));
+		failing_loop::failing() = 1;
+		// wakes the shard, unless it already failed and passed it on.
+		curl::easy next;
+		prepare(next, "/quick");
+		pool.submit(pin, next, r.callback());
+		CHECK(r.wait(2));
+		CHECK(eventually([&] { return !pool.alive(1); }));
+		CHECK(pool.alive(0));
+		CHECK(r.codes.size() == 2);
+		CHECK(r.codes.front() == CURLE_ABORTED_BY_CALLBACK || r.codes.back() == CURLE_ABORTED_BY_CALLBACK);
+		gate(true);
+
+		std::vector<curl::easy> handles(8);
+		results after;
+		for (size_t i = 0; i < handles.size(); ++i) {
+			prepare(handles[i], "/quick");
+			if (i % 2 == 0) {
+				pool.submit(1, handles[i], after.callback());
+			} else {
+				auto host = curl::host_key::from_url(("http://host" + std::to_string(i)).c_str());
+				pool.submit(host, handles[i], after.callback());
+			}
+		}
+		CHECK(after.wait(handles.size()));
+		CHECK(after.all_ok());
+		for (int i = 0; i < 100; ++i) {
+			auto host = curl::host_key::from_url(("http://host" + std::to_string(i)).c_str());
+			CHECK(pool.route(host) != 1);
+		}
+		CHECK(pool.stats(1).queued == 0);
+		CHECK(pool.stats(1).running == 0);
+	}
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
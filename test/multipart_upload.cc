@@ -0,0 +1,91 @@
+/* Every part reaches the server intact with its own ETag, a 503 or a 429
+ * is retried, and a 403 fails the upload.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multipart_upload.hpp"
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+
+int main() try {
+	auto g = curl::global();
+	auto data = test::pattern(2500001);
+	std::ofstream("multipart_upload.in", std::ios::binary) << data;
+	std::ofstream("multipart_upload.empty", std::ios::binary);
+
+	std::mutex mutex;
+	auto stored = std::map<std::string, std::string>();
+	auto seen = std::map<std::string, int>();
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		std::lock_guard<std::mutex> lock(mutex);
+		auto n = ++seen[r.path];
+		if (r.method != "PUT" || r.path.find("/deny/") == 0) {
+			res.status = 403;
+		} else if (r.path.find("/busy/") == 0 && n == 1) {
+			res.status = 503;
+		} else if (r.path.find("/limited/") == 0 && n == 1) {
+			res.status = 429;
+		} else {
+			stored[r.path] = r.body;
+			res.headers.emplace_back("ETag", "\"e" + r.path.substr(r.path.rfind('/') + 1) + "\"");
+		}
+		return res;
+	});
+	auto o = curl::multipart_upload<>::options();
+	o.part_size = 1024 * 1024;
+	o.parallel  = 2;
+	auto upload = [&](const char* file, std::string const& dir) {
+		auto proto = curl::prototype();
+		curl::multipart_upload<> up(proto, file, [&](size_t n) {
+			return s.url(dir + std::to_string(n));
+		}, o);
+		auto result = curl::code(CURLE_OK);
+		try {
+			up.run();
+		} catch (curl::code const& c) {
+			result = c;
+		}
+		return std::make_pair(result, up.parts());
+	};
+
+	for (auto dir : { "/ok/", "/busy/", "/limited/" }) {
+		auto r = upload("multipart_upload.in", dir);
+		CHECK(r.first == CURLE_OK);
+		CHECK(r.second.size() == 3);
+		auto joined = std::string();
+		for (auto& p : r.second) {
+			auto path = dir + std::to_string(p.number);
+			CHECK(p.status == 200);
+			CHECK(p.etag == "\"e" + std::to_string(p.number) + "\"");
+			CHECK(p.attempts == (dir == std::string("/ok/") ? 1u : 2u));
+			CHECK(stored[path].size() == p.length);
+			joined += stored[path];
+		}
+		CHECK(joined == data);
+	}
+	{
+		auto r = upload("multipart_upload.in", "/deny/");
+		CHECK(r.first == CURLE_HTTP_RETURNED_ERROR);
+		for (auto& p : r.second) {
+			CHECK(p.attempts <= 1);
+		}
+	}
+	{
+		auto r = upload("multipart_upload.empty", "/empty/");
+		CHECK(r.first == CURLE_OK);
+		CHECK(r.second.size() == 1);
+		CHECK(stored.count("/empty/1") == 1);
+		CHECK(stored["/empty/1"].empty());
+	}
+	::unlink("multipart_upload.in");
+	::unlink("multipart_upload.empty");
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,79 @@
+/* A download is uploaded as it arrives, with its length passed on when
+ * known, and an error status of either side fails the copy.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/pipe.hpp"
+#include "curl++/submission_queue.hpp"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+int main() try {
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	auto data = test::pattern(2000000);
+	std::mutex mutex;
+	auto stored = std::map<std::string, test::request>();
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		if (r.path.find("/dst/") == 0) {
+			std::lock_guard<std::mutex> lock(mutex);
+			stored[r.path] = r;
+			res.status = r.path == "/dst/deny" ? 403 : 201;
+		} else if (r.path == "/empty-404") {
+			res.status = 404;
+		} else if (r.path == "/404") {
+			res.status = 404;
+			res.body   = "not found";
+		} else if (r.path != "/empty") {
+			res.body    = data;
+			res.chunked = r.path == "/chunked";
+		}
+		return res;
+	});
+
+	auto m = curl::multi();
+	curl::epoll_loop loop(m);
+	curl::submission_queue<curl::epoll_loop> queue(m, loop);
+	auto copy = [&](const char* from, const char* to) {
+		auto src = curl::easy();
+		auto dst = curl::easy();
+		src.url(s.url(from));
+		dst.url(s.url(to));
+		curl::pipe<curl::epoll_loop> p(queue, 0);
+		p.start(src, dst);
+		while (!p.done()) {
+			loop.run_once(100ms);
+			queue.drain();
+			m.dispatch();
+		}
+		return p.result();
+	};
+
+	CHECK(copy("/sized", "/dst/sized") == CURLE_OK);
+	CHECK(stored["/dst/sized"].body == data);
+	CHECK(stored["/dst/sized"].header("content-length") == std::to_string(data.size()));
+	CHECK(copy("/chunked", "/dst/chunked") == CURLE_OK);
+	CHECK(stored["/dst/chunked"].body == data);
+	CHECK(stored["/dst/chunked"].chunked);
+	CHECK(copy("/empty", "/dst/empty") == CURLE_OK);
+	CHECK(stored.count("/dst/empty") == 1);
+	CHECK(stored["/dst/empty"].body.empty());
+
+	// nothing is uploaded for an error status, with or without a body.
+	CHECK(copy("/404", "/dst/404") == CURLE_HTTP_RETURNED_ERROR);
+	CHECK(copy("/empty-404", "/dst/empty-404") == CURLE_HTTP_RETURNED_ERROR);
+	CHECK(stored.count("/dst/404") == 0);
+	CHECK(stored.count("/dst/empty-404") == 0);
+
+	CHECK(copy("/sized", "/dst/deny") == CURLE_HTTP_RETURNED_ERROR);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
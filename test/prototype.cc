@@ -0,0 +1,93 @@
+/* Clones carry the options of the prototype, and their handlers refer to
+ * the clone rather than anything set on the prototype.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/global.hpp"
+#include "curl++/prototype.hpp"
+#include <string>
+
+struct request : curl::easy_base<request> {
+	using easy_base<request>::easy_base;
+
+	auto on(curl::easy::write w) noexcept -> size_t
+	{
+		body.append(w.data(), w.size());
+		return w.size();
+	}
+	std::string body;
+};
+
+struct tagged : curl::easy_base<tagged> {
+	tagged(curl::easy_ref e, int id) noexcept
+	: easy_base<tagged>(e)
+	, id(id)
+	{}
+
+	auto on(curl::easy::write w) noexcept -> size_t
+	{
+		body.append(w.data(), w.size());
+		return w.size();
+	}
+	int         id;
+	std::string body;
+};
+
+int main() try {
+	auto g = curl::global();
+	test::server s([](test::request const& r) {
+		auto res = test::response();
+		if (r.path == "/moved") {
+			res.status = 302;
+			res.headers.emplace_back("Location", "/here");
+		} else {
+			res.body = r.header("user-agent") + " " + r.path;
+		}
+		return res;
+	});
+
+	auto proto = curl::prototype();
+	proto.handle().follow_location(true);
+	proto.setopt(CURLOPT_USERAGENT, "proto-agent");
+	// a handler on the prototype must not leak into the clones.
+	auto stray = request();
+	proto.handle().set_handler<curl::easy::write>(&stray);
+
+	auto a = proto.make_unique<request>();
+	auto b = proto.make_unique<request>();
+	a->url(s.url("/moved"));
+	b->url(s.url("/b"));
+	a->perform();
+	b->perform();
+	CHECK(a->body == "proto-agent /here");
+	CHECK(b->body == "proto-agent /b");
+	CHECK(a->redirect_count() == 1);
+
+	auto t = proto.make_unique<tagged>(7);
+	t->url(s.url("/t"));
+	t->perform();
+	CHECK(t->id == 7);
+	CHECK(t->body == "proto-agent /t");
+
+	auto c = request();
+	proto.clone_into(c);
+	c.url(s.url("/c"));
+	c.perform();
+	CHECK(c.body == "proto-agent /c");
+	CHECK(stray.body.empty());
+
+	// changing the prototype leaves existing clones alone.
+	proto.setopt(CURLOPT_USERAGENT, "other");
+	b->body.clear();
+	b->perform();
+	CHECK(b->body == "proto-agent /b");
+	auto d = proto.make();
+	d.url(s.url("/d"));
+	d.setopt(CURLOPT_NOBODY, 1L);
+	d.perform();
+	CHECK(d.response_code() == 200);
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
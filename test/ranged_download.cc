@@ -0,0 +1,151 @@
+/* Ranges are fetched in parallel and resumed where they stopped, error
+ * bodies never reach the file, and only transient statuses are retried.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/global.hpp"
+#include "curl++/ranged_download.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+
+static auto slurp(const char* path) -> std::string
+{
+	auto f = std::ifstream(path, std::ios::binary);
+	return { std::istreambuf_iterator<char>(f), {} };
+}
+
+int main() try {
+	auto g = curl::global();
+	auto data = test::pattern(3000001);
+	std::mutex mutex;
+	auto seen = std::map<std::string, int>();
+	auto gets = std::map<std::string, int>();
+	test::server s([&](test::request const& r) {
+		auto path = r.path.substr(0, r.path.find('?'));
+		auto first = false;
+		if (r.method == "GET") {
+			std::lock_guard<std::mutex> lock(mutex);
+			// a resumed range keeps its end.
+			auto range = r.header("range");
+			first = ++seen[r.path + range.substr(std::min(range.size(), range.find('-')))] == 1;
+			++gets[r.path];
+		}
+		auto res = test::response();
+		if (path == "/empty") {
+			return res;
+		}
+		if (r.method == "HEAD" && path == "/nohead") {
+			res.status = 405;
+			return res;
+		}
+		if (r.method == "GET" && path == "/gone") {
+			res.status = 404;
+			res.body   = "not found";
+			return res;
+		}
+		if (r.method == "GET" && path == "/norange") {
+			res.body = data;
+			return res;
+		}
+		if (first && (path == "/busy" || path == "/slow-down")) {
+			res.status = path == "/busy" ? 503 : 429;
+			res.body   = "<html>try again later</html>";
+			return res;
+		}
+		res = test::serve_range(r, data);
+		if (first && path == "/cut" && res.status == 206) {
+			// half of the range, as if the connection dropped.
+			res.body.resize(res.body.size() / 2);
+		}
+		return res;
+	});
+	auto o = curl::ranged_download<>::options();
+	o.parts    = 4;
+	o.min_part = 256 * 1024;
+	auto fetch = [&](const char* path, curl::ranged_download<>::options o) {
+		auto proto = curl::prototype();
+		proto.handle().url(s.url(path));
+		curl::ranged_download<> d(proto, "ranged_download.out", o);
+		auto result = curl::code(CURLE_OK);
+		try {
+			d.run();
+		} catch (curl::code const& c) {
+			result = c;
+		}
+		return std::make_pair(result, d.ranges());
+	};
+
+	{
+		auto r = fetch("/plain", o);
+		CHECK(r.first == CURLE_OK);
+		CHECK(r.second.size() == 4);
+		for (auto& p : r.second) {
+			CHECK(p.attempts == 1);
+			CHECK(p.written == p.length);
+		}
+		CHECK(slurp("ranged_download.out") == data);
+	}
+	for (auto path : { "/busy", "/slow-down", "/cut" }) {
+		auto r = fetch(path, o);
+		CHECK(r.first == CURLE_OK);
+		for (auto& p : r.second) {
+			CHECK(p.attempts == 2);
+			CHECK(p.result == CURLE_OK);
+		}
+		// no error page and no gap where the first attempt stopped.
+		CHECK(slurp("ranged_download.out") == data);
+	}
+	{
+		auto r = fetch("/empty", o);
+		CHECK(r.first == CURLE_OK);
+		CHECK(r.second.empty());
+		CHECK(gets["/empty"] == 0);
+		CHECK(slurp("ranged_download.out").empty());
+	}
+	{
+		auto r = fetch("/gone", o);
+		CHECK(r.first == CURLE_HTTP_RETURNED_ERROR);
+		for (auto& p : r.second) {
+			CHECK(p.attempts == 1);
+			CHECK(p.written == 0);
+		}
+	}
+	{
+		auto r = fetch("/norange", o);
+		CHECK(r.first == CURLE_RANGE_ERROR);
+		CHECK(gets["/norange"] == 4);
+	}
+	{
+		auto r = fetch("/nohead", o);
+		CHECK(r.first == CURLE_OK);
+		CHECK(r.second.size() == 1);
+		CHECK(r.second.front().length == data.size());
+		CHECK(seen.count("/nohead") == 1);
+		CHECK(slurp("ranged_download.out") == data);
+	}
+	{
+		// without retries the first error is final.
+		auto once = o;
+		once.retries = 0;
+		auto r = fetch("/busy?once", once);
+		CHECK(r.first == CURLE_HTTP_RETURNED_ERROR);
+		for (auto& p : r.second) {
+			CHECK(p.written == 0);
+		}
+		r = fetch("/cut?once", once);
+		CHECK(r.first == CURLE_PARTIAL_FILE);
+		for (auto& p : r.second) {
+			CHECK(p.written == p.length / 2);
+		}
+	}
+	::unlink("ranged_download.out");
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,187 @@
+/* The scheduler keeps within its global and per host limits, admits
+ * interactive requests ahead of bulk ones, and expires requests whose
+ * deadline passes while queued, even behind a saturated host.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/scheduler.hpp"
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using scheduler = curl::scheduler<>;
+
+struct nowrite {
+	static size_t on(curl::easy::write w) {
+		return w.size();
+	}
+};
+
+int main() try {
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	std::mutex mutex;
+	auto busy = std::map<std::string, int>();
+	auto peak = std::map<std::string, int>();
+	test::server s([&](test::request const& r) {
+		auto host = r.header("host").substr(0, r.header("host").find(':'));
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto n = ++busy[host];
+			++busy[""];
+			peak[host] = std::max(peak[host], n);
+			peak[""] = std::max(peak[""], busy[""]);
+		}
+		std::this_thread::sleep_for(r.path == "/long" ? 800ms : 20ms);
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--busy[host];
+			--busy[""];
+		}
+		return test::response();
+	});
+
+	auto m = curl::multi();
+	curl::epoll_loop loop(m);
+	auto run = [&](scheduler& sched) {
+		while (sched.queued() + sched.running() > 0) {
+			loop.run_once(sched.timeout());
+			m.dispatch();
+			sched.expire();
+		}
+	};
+
+	// limits: three at once, two per host.
+	{
+		scheduler sched(m, { 3, 3, 0 }, curl::fixed_limit{ 2 });
+		auto handles = std::vector<std::unique_ptr<curl::easy>>();
+		auto ok = 0;
+		for (auto host : { "127.0.0.1", "localhost" }) {
+			for (int i = 0; i < 6; ++i) {
+				handles.emplace_back(new curl::easy);
+				auto& e = *handles.back();
+				auto url = s.url("/" + std::to_string(i));
+				url.replace(url.find("127.0.0.1"), 9, host);
+				e.url(url);
+				e.set_handler<curl::easy::write, nowrite>();
+				sched.submit(e, curl::host_key::from_url(url.c_str()), scheduler::bulk,
+					[&](curl::easy_ref, curl::code c, scheduler::timings) {
+						ok += !c;
+					});
+			}
+		}
+		CHECK(sched.running() == 3);
+		CHECK(sched.queued() == 9);
+		run(sched);
+		CHECK(ok == 12);
+		CHECK(peak[""] <= 3);
+		CHECK(peak["127.0.0.1"] <= 2);
+		CHECK(peak["localhost"] <= 2);
+	}
+
+	// one at a time: the interactive request overtakes queued bulk ones.
+	{
+		scheduler sched(m, { 1, 1, 0 });
+		auto handles = std::vector<std::unique_ptr<curl::easy>>();
+		auto order = std::string();
+		auto submit = [&](char name, scheduler::priority p,
+		                  scheduler::clock::time_point deadline) {
+			handles.emplace_back(new curl::easy);
+			auto& e = *handles.back();
+			auto url = s.url("/");
+			e.url(url);
+			e.set_handler<curl::easy::write, nowrite>();
+			sched.submit(e, curl::host_key::from_url(url.c_str()), p,
+				[&order, name](curl::easy_ref, curl::code c, scheduler::timings) {
+					order += c ? char(name - 'a' + 'A') : name;
+				}, deadline);
+		};
+		auto never = scheduler::clock::time_point::max();
+		submit('a', scheduler::bulk, never);
+		submit('b', scheduler::bulk, never);
+		submit('c', scheduler::bulk, scheduler::clock::now());
+		submit('i', scheduler::interactive, never);
+		CHECK(sched.running(scheduler::bulk) == 1);
+		run(sched);
+		// c expired on submission, upper case marks the failure.
+		CHECK(order == "Caib");
+	}
+
+	// waiting behind a busy host or a full scheduler does not delay expiry.
+	{
+		scheduler sched(m, { 2, 2, 0 }, curl::fixed_limit{ 1 });
+		auto handles = std::vector<std::unique_ptr<curl::easy>>();
+		auto start = scheduler::clock::now();
+		auto results = std::map<std::string, CURLcode>();
+		auto when = std::map<std::string, scheduler::clock::duration>();
+		auto running = std::map<std::string, size_t>();
+		auto submit = [&](std::string name, const char* host, const char* path,
+		                  scheduler::clock::duration deadline) {
+			handles.emplace_back(new curl::easy);
+			auto& e = *handles.back();
+			auto url = s.url(path);
+			url.replace(url.find("127.0.0.1"), 9, host);
+			e.url(url);
+			e.set_handler<curl::easy::write, nowrite>();
+			auto at = deadline == scheduler::clock::duration::max()
+			        ? scheduler::clock::time_point::max()
+			        : scheduler::clock::now() + deadline;
+			sched.submit(e, curl::host_key::from_url(url.c_str()), scheduler::bulk,
+				[&, name](curl::easy_ref, curl::code c, scheduler::timings) {
+					results[name] = c.value;
+					when[name]    = scheduler::clock::now() - start;
+					running[name] = sched.running();
+				}, at);
+		};
+		auto never = scheduler::clock::duration::max();
+		submit("busy", "127.0.0.1", "/long", never);
+		// behind busy, which holds the only slot of its host.
+		submit("same host", "127.0.0.1", "/", 100ms);
+		submit("other host", "localhost", "/long", never);
+		// behind the two running, which fill the scheduler.
+		submit("full", "localhost", "/", 150ms);
+		// admitted at once, with what is left of its deadline as timeout.
+		{
+			scheduler other(m, { 1, 1, 0 });
+			handles.emplace_back(new curl::easy);
+			auto& e = *handles.back();
+			e.url(s.url("/long"));
+			e.set_handler<curl::easy::write, nowrite>();
+			other.submit(e, curl::host_key::from_url(s.url("/").c_str()), scheduler::bulk,
+				[&](curl::easy_ref, curl::code c, scheduler::timings) {
+					results["admitted"] = c.value;
+					when["admitted"]    = scheduler::clock::now() - start;
+				}, scheduler::clock::now() + 200ms);
+			CHECK(other.running() == 1);
+			while (other.running() > 0) {
+				loop.run_once(sched.timeout());
+				m.dispatch();
+				sched.expire();
+			}
+		}
+		CHECK(sched.running() == 2);
+		run(sched);
+		CHECK(results["same host"] == CURLE_OPERATION_TIMEDOUT);
+		CHECK(results["full"] == CURLE_OPERATION_TIMEDOUT);
+		CHECK(results["admitted"] == CURLE_OPERATION_TIMEDOUT);
+		CHECK(results["busy"] == CURLE_OK);
+		CHECK(results["other host"] == CURLE_OK);
+		// well before the running ones finished.
+		CHECK(when["same host"] >= 100ms && when["same host"] < 500ms);
+		CHECK(when["full"] >= 150ms && when["full"] < 500ms);
+		CHECK(when["admitted"] >= 190ms && when["admitted"] < 600ms);
+		CHECK(running["same host"] == 2);
+		CHECK(running["full"] == 2);
+	}
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
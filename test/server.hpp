@@ -0,0 +1,382 @@
+#ifndef CURLPLUSPLUS_TEST_SERVER_HPP
+#define CURLPLUSPLUS_TEST_SERVER_HPP
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <system_error>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace test {
+
+struct request {
+	std::string                        method;
+	std::string                        path;
+	std::map<std::string, std::string> headers; // names in lower case.
+	std::string                        body;
+	bool                               chunked = false;
+
+	auto header(std::string const& name) const -> std::string
+	{
+		auto it = headers.find(name);
+		return it == headers.end() ? std::string() : it->second;
+	}
+};
+
+struct response {
+	int                                              status = 200;
+	std::vector<std::pair<std::string, std::string>> headers;
+	std::string                                      body;
+	bool                                             chunked = false;
+};
+
+/**
+ * HTTP/1.1 server on a free port of the loopback interface, so tests can
+ * check transfers without a network.
+ *
+ * Every connection is served on its own thread and closed after one
+ * request, unless keep_alive is set, so concurrent transfers of one test
+ * see each other in flight.
+ * Request bodies are read in full before the handler is called, either
+ * by length or chunked.
+ *
+ * example usage:
+ * @code
+ *   test::server s([](test::request const& r) {
+ *     test::response res;
+ *     res.body = r.path;
+ *     return res;
+ *   });
+ *   e.url(s.url("/hello"));
+ * @endcode
+ */
+struct server {
+	using handler = std::function<response(request const&)>;
+
+	/**
+	 * @param keep_alive serve further requests on a connection until the
+	 *        client closes it.
+	 * @throws std::system_error
+	 */
+	explicit server(handler h, bool keep_alive = false)
+	: _handler(std::move(h))
+	, _keep_alive(keep_alive)
+	, _fd(::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0))
+	{
+		if (_fd < 0) {
+			throw std::system_error(errno, std::generic_category(), "socket");
+		}
+		auto addr = sockaddr_in();
+		addr.sin_family      = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		auto len = socklen_t(sizeof addr);
+		auto sa  = reinterpret_cast<sockaddr*>(&addr);
+		if (::bind(_fd, sa, len) != 0 || ::listen(_fd, 128) != 0
+		 || ::getsockname(_fd, sa, &len) != 0) {
+			auto e = errno;
+			::close(_fd);
+			throw std::system_error(e, std::generic_category(), "listen");
+		}
+		_port   = ntohs(addr.sin_port);
+		_thread = std::thread([this] { accept_loop(); });
+	}
+
+	server(server const&) = delete;
+	auto operator=(server const&) -> server& = delete;
+
+	~server() noexcept
+	{
+		_stop.store(true);
+		::shutdown(_fd, SHUT_RDWR);
+		_thread.join();
+		::close(_fd);
+		for (auto& t : _connections) {
+			t.join();
+		}
+	}
+
+	/**
+	 * @returns url of path on this server.
+	 */
+	auto url(std::string const& path) const -> std::string
+	{
+		return "http://127.0.0.1:" + std::to_string(_port) + path;
+	}
+
+	/**
+	 * @returns number of requests answered so far.
+	 */
+	auto requests() const noexcept -> size_t
+	{
+		return _requests.load();
+	}
+
+	/**
+	 * @returns number of connections accepted so far.
+	 */
+	auto connections() const noexcept -> size_t
+	{
+		return _accepted.load();
+	}
+
+private:
+	/**
+	 * Buffered reads from a connection.
+	 */
+	struct reader {
+		int         fd;
+		std::string buf;
+		size_t      pos = 0;
+
+		auto fill() -> bool
+		{
+			char tmp[16384];
+			auto n = ::recv(fd, tmp, sizeof tmp, 0);
+			if (n <= 0) {
+				return false;
+			}
+			buf.append(tmp, static_cast<size_t>(n));
+			return true;
+		}
+
+		auto line(std::string& out) -> bool
+		{
+			auto end = std::string::npos;
+			while ((end = buf.find("\r\n", pos)) == std::string::npos) {
+				if (!fill()) {
+					return false;
+				}
+			}
+			out.assign(buf, pos, end - pos);
+			pos = end + 2;
+			return true;
+		}
+
+		auto read(std::string& out, size_t n) -> bool
+		{
+			while (buf.size() - pos < n) {
+				if (!fill()) {
+					return false;
+				}
+			}
+			out.append(buf, pos, n);
+			pos += n;
+			return true;
+		}
+	};
+
+	void accept_loop()
+	{
+		for (;;) {
+			auto c = ::accept4(_fd, nullptr, nullptr, SOCK_CLOEXEC);
+			if (c < 0) {
+				if (!_stop.load() && (errno == EINTR || errno == ECONNABORTED)) {
+					continue;
+				}
+				return;
+			}
+			// a client that stops sending must not hang the test.
+			auto tv = timeval{ 10, 0 };
+			::setsockopt(c, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof tv);
+			++_accepted;
+			std::lock_guard<std::mutex> lock(_mutex);
+			_connections.emplace_back([this, c] { serve(c); });
+		}
+	}
+
+	void serve(int fd)
+	{
+		auto in  = reader{ fd, {} };
+		auto req = request();
+		while (read_request(in, req)) {
+			auto res = response();
+			try {
+				res = _handler(req);
+			} catch (std::exception const& e) {
+				res = response();
+				res.status = 500;
+				res.body   = e.what();
+			}
+			++_requests;
+			if (!write_response(fd, req, res, _keep_alive) || !_keep_alive) {
+				break;
+			}
+			req = request();
+		}
+		::close(fd);
+	}
+
+	static auto read_request(reader& in, request& req) -> bool
+	{
+		auto line = std::string();
+		if (!in.line(line)) {
+			return false;
+		}
+		auto sp1 = line.find(' ');
+		auto sp2 = line.find(' ', sp1 + 1);
+		if (sp1 == std::string::npos || sp2 == std::string::npos) {
+			return false;
+		}
+		req.method = line.substr(0, sp1);
+		req.path   = line.substr(sp1 + 1, sp2 - sp1 - 1);
+		while (in.line(line) && !line.empty()) {
+			auto colon = line.find(':');
+			if (colon == std::string::npos) {
+				continue;
+			}
+			auto name  = line.substr(0, colon);
+			auto start = line.find_first_not_of(' ', colon + 1);
+			auto value = start == std::string::npos ? std::string() : line.substr(start);
+			std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+			req.headers[name] = value;
+		}
+		if (req.header("expect") == "100-continue") {
+			send_all(in.fd, "HTTP/1.1 100 Continue\r\n\r\n");
+		}
+		if (req.header("transfer-encoding") == "chunked") {
+			req.chunked = true;
+			for (;;) {
+				if (!in.line(line)) {
+					return false;
+				}
+				auto n = std::strtoul(line.c_str(), nullptr, 16);
+				if (n == 0) {
+					while (in.line(line) && !line.empty()) {
+					}
+					return true;
+				}
+				if (!in.read(req.body, n) || !in.line(line)) {
+					return false;
+				}
+			}
+		}
+		auto length = req.header("content-length");
+		return length.empty() || in.read(req.body, std::stoul(length));
+	}
+
+	/**
+	 * @returns false if the connection can not be used any more.
+	 */
+	static auto write_response(int fd, request const& req, response const& res,
+	                           bool keep_alive) -> bool
+	{
+		auto head = "HTTP/1.1 " + std::to_string(res.status) + " Status\r\n";
+		for (auto& h : res.headers) {
+			head += h.first + ": " + h.second + "\r\n";
+		}
+		if (res.chunked) {
+			head += "Transfer-Encoding: chunked\r\n";
+		} else {
+			head += "Content-Length: " + std::to_string(res.body.size()) + "\r\n";
+		}
+		head += keep_alive ? "\r\n" : "Connection: close\r\n\r\n";
+		if (!send_all(fd, head)) {
+			return false;
+		}
+		if (req.method == "HEAD") {
+			return true;
+		}
+		if (!res.chunked) {
+			return send_all(fd, res.body);
+		}
+		for (size_t i = 0; i < res.body.size(); i += 16384) {
+			auto n = std::min<size_t>(16384, res.body.size() - i);
+			char size[32];
+			snprintf(size, sizeof size, "%zx\r\n", n);
+			if (!send_all(fd, size) || !send_all(fd, res.body.substr(i, n) + "\r\n")) {
+				return false;
+			}
+		}
+		return send_all(fd, "0\r\n\r\n");
+	}
+
+	static auto send_all(int fd, std::string const& s) -> bool
+	{
+		for (size_t i = 0; i < s.size(); ) {
+			auto n = ::send(fd, s.data() + i, s.size() - i, MSG_NOSIGNAL);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				return false;
+			}
+			i += static_cast<size_t>(n);
+		}
+		return true;
+	}
+
+	handler                  _handler;
+	bool                     _keep_alive;
+	int                      _fd;
+	int                      _port = 0;
+	std::atomic<bool>        _stop{false};
+	std::atomic<size_t>      _requests{0};
+	std::atomic<size_t>      _accepted{0};
+	std::thread              _thread;
+	std::mutex               _mutex;
+	std::vector<std::thread> _connections;
+};
+
+/**
+ * Answer a GET or HEAD of data, with the part a Range header asks for.
+ */
+inline auto serve_range(request const& req, std::string const& data) -> response
+{
+	auto res = response();
+	res.headers.emplace_back("Accept-Ranges", "bytes");
+	auto range = req.header("range");
+	size_t first = 0;
+	size_t last  = 0;
+	auto   n     = std::sscanf(range.c_str(), "bytes=%zu-%zu", &first, &last);
+	if (n < 1) {
+		res.body = data;
+		return res;
+	}
+	if (n < 2 || last >= data.size()) {
+		last = data.size() - 1;
+	}
+	if (first >= data.size() || first > last) {
+		res.status = 416;
+		res.headers.emplace_back("Content-Range", "bytes */" + std::to_string(data.size()));
+		return res;
+	}
+	res.status = 206;
+	res.headers.emplace_back("Content-Range", "bytes " + std::to_string(first) + "-"
+	                         + std::to_string(last) + "/" + std::to_string(data.size()));
+	res.body = data.substr(first, last - first + 1);
+	return res;
+}
+
+/**
+ * @returns n bytes that differ from one offset to the next, so a byte in
+ *          the wrong place shows.
+ */
+inline auto pattern(size_t n) -> std::string
+{
+	auto s = std::string(n, '\0');
+	auto x = uint32_t(2463534242);
+	for (auto& c : s) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		c = static_cast<char>(x);
+	}
+	return s;
+}
+
+} // namespace test
+#endif // CURLPLUSPLUS_TEST_SERVER_HPP
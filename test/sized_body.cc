@@ -0,0 +1,87 @@
+/* A body with Content-Length is stored in one buffer, one without in
+ * slabs, and only the final response of a redirect counts.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/easy.hpp"
+#include "curl++/global.hpp"
+#include "curl++/sized_body.hpp"
+#include <string>
+
+struct request : curl::easy_base<request> {
+	explicit request(size_t max_reserve = 64 * 1024 * 1024)
+	: body(max_reserve)
+	{}
+
+	auto on(header h) noexcept -> size_t { return body.on(h); }
+	auto on(write w) noexcept -> size_t { return body.on(w); }
+
+	curl::sized_body body;
+};
+
+int main() try {
+	auto g = curl::global();
+	auto data = test::pattern(200000);
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		if (r.path == "/moved") {
+			res.status = 301;
+			res.body   = "moved elsewhere";
+			res.headers.emplace_back("Location", "/sized");
+			return res;
+		}
+		res.body    = data;
+		res.chunked = r.path == "/chunked";
+		return res;
+	});
+
+	{
+		auto e = request();
+		e.url(s.url("/sized"));
+		e.perform();
+		CHECK(e.body.contiguous());
+		CHECK(e.body.expected() == data.size());
+		CHECK(e.body.size() == data.size());
+		CHECK(std::string(e.body.buffer().data(), e.body.buffer().size()) == data);
+	}
+	{
+		auto e = request();
+		e.url(s.url("/chunked"));
+		e.perform();
+		CHECK(!e.body.contiguous());
+		CHECK(e.body.expected() == curl::sized_body::unknown);
+		CHECK(e.body.chunks().str() == data);
+		CHECK(e.body.str() == data);
+	}
+	{
+		auto e = request();
+		e.url(s.url("/moved"));
+		e.follow_location(true);
+		e.perform();
+		CHECK(e.body.expected() == data.size());
+		CHECK(e.body.str() == data);
+	}
+	{
+		// a reservation capped below the length still takes it all.
+		auto e = request(1000);
+		e.url(s.url("/sized"));
+		e.perform();
+		CHECK(e.body.contiguous());
+		CHECK(e.body.str() == data);
+		e.body.clear();
+		CHECK(e.body.size() == 0);
+		CHECK(e.body.expected() == curl::sized_body::unknown);
+	}
+	{
+		auto e = request();
+		e.url(s.url("/sized"));
+		e.no_body(true);
+		e.perform();
+		CHECK(e.body.expected() == data.size());
+		CHECK(e.body.size() == 0);
+	}
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
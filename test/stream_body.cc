@@ -0,0 +1,66 @@
+/* A consumer slower than the network gets the whole body in order, with
+ * the transfer paused and resumed as the small ring fills and drains.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/completion.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/stream_body.hpp"
+#include "curl++/submission_queue.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+
+int main() try {
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	auto data = test::pattern(2000000);
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		res.body    = data;
+		res.chunked = r.path == "/chunked";
+		return res;
+	});
+
+	auto m = curl::multi();
+	curl::epoll_loop loop(m);
+	curl::submission_queue<curl::epoll_loop> queue(m, loop);
+	for (auto path : { "/sized", "/chunked" }) {
+		auto e = curl::easy();
+		e.url(s.url(path));
+		curl::stream_body<curl::epoll_loop> body(queue, 0);
+		curl::completion done{ &body };
+		CHECK(body.capacity() >= CURL_MAX_WRITE_SIZE);
+		body.attach(e);
+		done.attach(e);
+		queue.add(e);
+
+		auto got = std::string();
+		auto consumer = std::thread([&] {
+			char buf[7000];
+			auto i = 0;
+			while (auto n = body.read({ buf, sizeof buf })) {
+				got.append(buf, n);
+				if (++i % 64 == 0) {
+					std::this_thread::sleep_for(1ms);
+				}
+			}
+		});
+		while (!body.closed()) {
+			loop.run_once(100ms);
+			queue.drain();
+			m.dispatch();
+		}
+		consumer.join();
+		CHECK(body.result() == CURLE_OK);
+		CHECK(got == data);
+		char c;
+		CHECK(body.read({ &c, 1 }) == 0);
+	}
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
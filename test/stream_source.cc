@@ -0,0 +1,83 @@
+/* A body written on another thread through a tiny ring reaches the
+ * server whole, chunked or with its size announced, and the last write
+ * before close is never lost.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/completion.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/stream_source.hpp"
+#include "curl++/submission_queue.hpp"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+
+int main() try {
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	auto data = test::pattern(1000003);
+	std::mutex mutex;
+	auto received = std::string();
+	auto chunked = false;
+	test::server s([&](test::request const& r) {
+		std::lock_guard<std::mutex> lock(mutex);
+		received = r.body;
+		chunked  = r.chunked;
+		return test::response();
+	});
+
+	auto m = curl::multi();
+	curl::epoll_loop loop(m);
+	curl::submission_queue<curl::epoll_loop> queue(m, loop);
+	auto upload = [&](std::string const& body, curl_off_t size, size_t capacity) {
+		auto e = curl::easy();
+		e.url(s.url("/"));
+		curl::stream_source<curl::epoll_loop> source(queue, capacity);
+		curl::completion done{ &source };
+		source.attach(e, size);
+		done.attach(e);
+		queue.add(e);
+		auto complete = true;
+		auto producer = std::thread([&] {
+			for (size_t i = 0, step = 1; i < body.size(); i += step, step = step * 3 % 9973 + 1) {
+				step = std::min(step, body.size() - i);
+				if (!source.write({ body.data() + i, step })) {
+					complete = false;
+					break;
+				}
+			}
+			source.close();
+		});
+		while (!source.done()) {
+			loop.run_once(100ms);
+			queue.drain();
+			m.dispatch();
+		}
+		producer.join();
+		CHECK(complete);
+		CHECK(source.result() == CURLE_OK);
+		CHECK(e.response_code() == 200);
+	};
+
+	upload(data, curl::stream_source<curl::epoll_loop>::unknown, 1024);
+	CHECK(chunked);
+	CHECK(received == data);
+	upload(data, static_cast<curl_off_t>(data.size()), 1024);
+	CHECK(!chunked);
+	CHECK(received == data);
+	// small bodies end right after the producer's only write.
+	for (int i = 0; i < 50; ++i) {
+		auto small = data.substr(0, static_cast<size_t>(i) * 37 + 1);
+		upload(small, curl::stream_source<curl::epoll_loop>::unknown, 1 << 16);
+		CHECK(received == small);
+	}
+	upload({}, curl::stream_source<curl::epoll_loop>::unknown, 1024);
+	CHECK(received.empty());
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,132 @@
+/* Producer threads add and cancel handles while the loop thread is
+ * blocked in poll(), which their submissions wake up long before its
+ * timeout. Added transfers all complete, cancelled ones never do.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/submission_queue.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct nowrite {
+	static auto on(curl::easy::write w) noexcept -> size_t
+	{
+		return w.size();
+	}
+};
+
+int main() try {
+	using namespace std::chrono;
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	std::mutex mutex;
+	std::condition_variable cv;
+	auto release = false;
+	test::server s([&](test::request const& r) {
+		if (r.path == "/hang") {
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait_for(lock, 10s, [&] { return release; });
+		}
+		return test::response();
+	});
+
+	auto m = curl::multi();
+	curl::submission_queue<curl::multi_ref> queue(m, m);
+
+	// a wakeup from another thread ends a blocked poll.
+	auto waker = std::thread([&] {
+		std::this_thread::sleep_for(100ms);
+		m.wakeup();
+	});
+	auto start = steady_clock::now();
+	m.poll(10s);
+	auto elapsed = steady_clock::now() - start;
+	waker.join();
+	CHECK(elapsed >= 50ms);
+	CHECK(elapsed < 5s);
+
+	auto const producers = 4;
+	auto const each      = 10;
+	std::vector<curl::easy> added(producers * each);
+	std::vector<curl::easy> cancelled(producers * each);
+	for (size_t i = 0; i < added.size(); ++i) {
+		added[i].url(s.url("/" + std::to_string(i)));
+		added[i].set_handler<curl::easy::write, nowrite>();
+		cancelled[i].url(s.url("/hang"));
+		cancelled[i].set_handler<curl::easy::write, nowrite>();
+	}
+	std::vector<std::thread> threads;
+	start = steady_clock::now();
+	for (int p = 0; p < producers; ++p) {
+		threads.emplace_back([&, p] {
+			for (int i = 0; i < each; ++i) {
+				auto k = static_cast<size_t>(p * each + i);
+				queue.add(cancelled[k]);
+				queue.add(added[k]);
+				std::this_thread::sleep_for(milliseconds(i % 3 * 5));
+				queue.cancel(cancelled[k]);
+			}
+		});
+	}
+
+	auto completed = size_t(0);
+	auto failed = size_t(0);
+	auto stray = size_t(0);
+	auto polls = 0;
+	auto running = 0;
+	while (completed < added.size() || running > 0 || !queue.empty()) {
+		// nothing here ends a poll early but the producers.
+		m.poll(10s);
+		++polls;
+		queue.drain();
+		running = m.perform();
+		for (auto msg : m.info_read()) {
+			if (msg->msg != CURLMSG_DONE) {
+				continue;
+			}
+			auto is_added = false;
+			for (auto& e : added) {
+				is_added = is_added || e.raw() == msg->ref.raw();
+			}
+			if (!is_added) {
+				++stray;
+			}
+			if (msg->result) {
+				++failed;
+			}
+			++completed;
+			m.remove_handle(msg->ref);
+		}
+		if (steady_clock::now() - start > 20s) {
+			break;
+		}
+	}
+	elapsed = steady_clock::now() - start;
+	for (auto& t : threads) {
+		t.join();
+	}
+	CHECK(completed == added.size());
+	CHECK(failed == 0);
+	CHECK(stray == 0);
+	CHECK(running == 0);
+	CHECK(queue.empty());
+	CHECK(elapsed < 5s);
+	CHECK(polls > 1);
+	// a cancel of a handle that already left the multi handle is harmless.
+	queue.cancel(added.front());
+	CHECK(queue.drain() == 1);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	release = true;
+	cv.notify_all();
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,95 @@
+/* Consumers of different speeds each get the whole body in order, while
+ * the slowest one holds back the transfer within tight limits.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/completion.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/submission_queue.hpp"
+#include "curl++/tee.hpp"
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+using tee = curl::tee<curl::epoll_loop>;
+
+int main() try {
+	using namespace std::chrono_literals;
+	auto g = curl::global();
+	auto data = test::pattern(1500000);
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		res.body    = data;
+		res.chunked = r.path == "/chunked";
+		return res;
+	});
+
+	auto m = curl::multi();
+	curl::epoll_loop loop(m);
+	curl::submission_queue<curl::epoll_loop> queue(m, loop);
+	auto o = tee::options();
+	o.max_bytes  = 64 * 1024;
+	o.max_chunks = 4;
+	for (auto path : { "/sized", "/chunked" }) {
+		auto e = curl::easy();
+		e.url(s.url(path));
+		tee t(queue, 3, o);
+		curl::completion done{ &t };
+		CHECK(t.consumers() == 3);
+		t.attach(e);
+		done.attach(e);
+		queue.add(e);
+
+		auto got = std::vector<std::string>(t.consumers());
+		auto threads = std::vector<std::thread>();
+		for (size_t i = 0; i < t.consumers(); ++i) {
+			threads.emplace_back([&, i] {
+				auto held = tee::chunk_ref();
+				auto n = 0;
+				while (auto c = t.next(i)) {
+					got[i].append(c.data(), c.size());
+					if (i == 2 && ++n % 8 == 0) {
+						// the slow consumer, holding on to a chunk.
+						held = std::move(c);
+						std::this_thread::sleep_for(1ms);
+					}
+				}
+			});
+		}
+		while (!t.closed()) {
+			loop.run_once(100ms);
+			queue.drain();
+			m.dispatch();
+		}
+		for (auto& th : threads) {
+			th.join();
+		}
+		CHECK(t.result() == CURLE_OK);
+		for (auto& body : got) {
+			CHECK(body == data);
+		}
+	}
+	{
+		// without consumers the body is dropped.
+		auto e = curl::easy();
+		e.url(s.url("/sized"));
+		tee t(queue, 0);
+		curl::completion done{ &t };
+		t.attach(e);
+		done.attach(e);
+		queue.add(e);
+		while (!t.closed()) {
+			loop.run_once(100ms);
+			queue.drain();
+			m.dispatch();
+		}
+		CHECK(t.result() == CURLE_OK);
+	}
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}
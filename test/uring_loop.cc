@@ -0,0 +1,142 @@
+/* The io_uring loop runs the same transfers as the epoll loop with the
+ * same results: concurrent downloads, an upload read in pieces, a timeout
+ * that only the timer can end, and a wakeup of a blocked run_once().
+ * Skipped where the kernel has no io_uring.
+ */
+#include "check.hpp"
+#include "server.hpp"
+#include "curl++/epoll_loop.hpp"
+#include "curl++/global.hpp"
+#include "curl++/multi.hpp"
+#include "curl++/uring_loop.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct fetch : curl::easy_base<fetch> {
+	auto on(curl::easy::write w) noexcept -> size_t
+	{
+		body.append(w.data(), w.size());
+		return w.size();
+	}
+	std::string body;
+	curl::code  result = CURLE_OK;
+};
+
+/**
+ * Run the transfers with Loop.
+ *
+ * @returns body or error of every transfer, in order.
+ */
+template<typename Loop>
+auto transfers(test::server& s, std::string const& data) -> std::vector<std::string>
+{
+	using namespace std::chrono;
+	using namespace std::chrono_literals;
+	auto m = curl::multi();
+	Loop loop(m);
+	CHECK(!loop.pending());
+
+	std::vector<std::unique_ptr<fetch>> fetches;
+	for (int i = 0; i < 10; ++i) {
+		fetches.emplace_back(new fetch);
+		fetches.back()->url(s.url("/" + std::to_string(i)));
+	}
+	fetches.emplace_back(new fetch);
+	auto& upload = *fetches.back();
+	upload.url(s.url("/upload"));
+	upload.setopt(CURLOPT_POSTFIELDSIZE_LARGE, static_cast<curl_off_t>(data.size()));
+	upload.setopt(CURLOPT_POSTFIELDS, data.data());
+	// the server never answers in time, so only the timer ends it.
+	fetches.emplace_back(new fetch);
+	auto& slow = *fetches.back();
+	slow.url(s.url("/slow"));
+	slow.setopt(CURLOPT_TIMEOUT_MS, 500L);
+	for (auto& f : fetches) {
+		m.add_handle(*f);
+	}
+
+	auto start = steady_clock::now();
+	loop.run();
+	auto elapsed = steady_clock::now() - start;
+	// one after the other would take three seconds.
+	CHECK(elapsed < 2s);
+	CHECK(elapsed >= 400ms);
+	CHECK(!loop.pending());
+	CHECK(loop.running() == 0);
+	for (auto msg : m.info_read()) {
+		if (msg->msg == CURLMSG_DONE) {
+			for (auto& f : fetches) {
+				if (f->raw() == msg->ref.raw()) {
+					f->result = msg->result;
+				}
+			}
+			m.remove_handle(msg->ref);
+		}
+	}
+	std::vector<std::string> results;
+	for (auto& f : fetches) {
+		results.push_back(f->result ? f->result.what() : f->body);
+	}
+
+	auto waker = std::thread([&] {
+		std::this_thread::sleep_for(100ms);
+		loop.wakeup();
+	});
+	start = steady_clock::now();
+	loop.run_once(10s);
+	elapsed = steady_clock::now() - start;
+	waker.join();
+	CHECK(elapsed >= 50ms);
+	CHECK(elapsed < 5s);
+	return results;
+}
+
+int main() try {
+	using namespace std::chrono_literals;
+	if (!curl::uring_loop::supported()) {
+		fprintf(stderr, "io_uring is not supported, skipping\n");
+		return 77;
+	}
+	auto g = curl::global();
+	auto data = test::pattern(1 << 20);
+	test::server s([&](test::request const& r) {
+		auto res = test::response();
+		if (r.method == "POST") {
+			res.body = std::to_string(r.body.size()) + (r.body == data ? " same" : " different");
+			return res;
+		}
+		std::this_thread::sleep_for(r.path == "/slow" ? 2s : 300ms);
+		res.body = r.path;
+		return res;
+	});
+
+	auto expected = std::vector<std::string>();
+	for (int i = 0; i < 10; ++i) {
+		expected.push_back("/" + std::to_string(i));
+	}
+	expected.push_back(std::to_string(data.size()) + " same");
+	expected.push_back(curl_easy_strerror(CURLE_OPERATION_TIMEDOUT));
+
+	auto with_epoll = transfers<curl::epoll_loop>(s, data);
+	auto with_uring = transfers<curl::uring_loop>(s, data);
+	CHECK(with_epoll == expected);
+	CHECK(with_uring == expected);
+	// and again on the same ring, after the timer was replaced and removed.
+	auto m = curl::multi();
+	curl::uring_loop loop(m);
+	for (int round = 0; round < 3; ++round) {
+		fetch f;
+		f.url(s.url("/again"));
+		m.add_handle(f);
+		loop.run();
+		CHECK(f.body == "/again");
+		m.remove_handle(f);
+	}
+	return test::result();
+} catch (std::exception const& e) {
+	fprintf(stderr, "%s\n", e.what());
+	return 1;
+}